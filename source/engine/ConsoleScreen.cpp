@@ -22,15 +22,19 @@
  * SOFTWARE.
  */
 
-#include <codecvt>
-#include <locale>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
 #include <sstream>
 #include <string>
 
 #include "ConsoleScreen.hpp"
-#include "Shader.hpp"
+#include "GLBackend.hpp"
 
 #include "FileCache.hpp"
+#include "Stats.hpp"
+#include "Utf8.hpp"
 
 namespace ge
 {
@@ -41,30 +45,31 @@ ConsoleScreen::ConsoleScreen()
 
 ConsoleScreen::~ConsoleScreen()
 {
-    if (m_bg_vao) glDeleteVertexArrays(1, &m_bg_vao);
-    if (m_bg_vbo) glDeleteBuffers(1, &m_bg_vbo);
-    if (m_fg_vao) glDeleteVertexArrays(1, &m_fg_vao);
-    if (m_fg_vbo) glDeleteBuffers(1, &m_fg_vbo);
-    if (m_atlas_texture) glDeleteTextures(1, &m_atlas_texture);
+    if (m_face) FT_Done_Face(m_face);
+    if (m_library) FT_Done_FreeType(m_library);
 }
 
 const void ConsoleScreen::create(uint32_t width, uint32_t height, std::string font_file, uint32_t font_width,
-                                 uint32_t font_height)
+                                 uint32_t font_height, const std::vector<GlyphRange> &preload_glyphs)
 {
     m_width            = width;
     m_height           = height;
     m_character_height = font_height;
     m_character_width  = font_width;
+    m_font_file        = font_file;
 
-    loadFont(font_file, m_character_height);
+    m_dirty_row_words = (m_width + 63) / 64;
+    m_dirty_bits.assign(m_dirty_row_words * m_height, 0);
+    m_dirty_rows.assign(m_height, 0);
+    markAllDirty();
+    m_touched_rows.assign(m_height, 0);
+    m_layers.assign(1, std::vector<Cell>(m_width * m_height, Cell{32, 2, 0, Cell::NONE}));
+    m_layer_visible.assign(1, 1);
+    m_layer = 0;
+    m_front = m_layers[0];
+    m_composite.resize(m_width);
 
-    m_console_dirty.resize(m_width * m_height, true);
-    m_console_bg.resize(m_width * m_height, 0);
-    m_console_fg.resize(m_width * m_height, 2);
-    m_console.resize(m_width * m_height, 32);
-
-    m_console_bg_vertices.resize(m_width * m_height * VERTS_PER_CELL);
-    m_console_fg_vertices.resize(m_width * m_height * VERTS_PER_CELL);
+    m_cell_instances.resize(m_width * m_height, CellInstance{0, 0, 0, 0});
 
     // some default C64 palette colors.
     m_palette_colors = {Color(0, 0, 0),
@@ -84,73 +89,40 @@ const void ConsoleScreen::create(uint32_t width, uint32_t height, std::string fo
                         Color(0, 136, 255),
                         Color(187, 187, 187)};
 
-    // set up the vertex buffer locations - we only do this once.
-    for (uint32_t y = 0; y < m_height; y++) {
-        for (uint32_t x = 0; x < m_width; x++) {
-            float v_left   = static_cast<float>(x * m_character_width);
-            float v_top    = static_cast<float>(y * m_character_height);
-            float v_width  = static_cast<float>(m_character_width);
-            float v_height = static_cast<float>(m_character_height);
-
-            setCellPositions(m_console_bg_vertices, Vec2i(x, y), v_left, v_top, v_width, v_height);
-            setCellPositions(m_console_fg_vertices, Vec2i(x, y), v_left, v_top, v_width, v_height);
-        }
-    }
-
-    initGL();
+    initBackend();
+    bakeAtlas(preload_glyphs);
 }
 
-void ConsoleScreen::initGL()
+void ConsoleScreen::setAtlasCacheDirectory(const std::filesystem::path &directory)
 {
-    const uint32_t total = m_width * m_height;
-    const size_t buf_size = total * VERTS_PER_CELL * sizeof(Vertex);
-
-    // Background VAO/VBO
-    glGenVertexArrays(1, &m_bg_vao);
-    glGenBuffers(1, &m_bg_vbo);
-    glBindVertexArray(m_bg_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, m_bg_vbo);
-    glBufferData(GL_ARRAY_BUFFER, buf_size, m_console_bg_vertices.data(), GL_STREAM_DRAW);
+    m_atlas_cache_directory = directory;
+}
 
-    // position: location 0
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, position));
-    glEnableVertexAttribArray(0);
-    // color: location 1 (normalized uint8)
-    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void *)offsetof(Vertex, color));
-    glEnableVertexAttribArray(1);
-    // texcoords: location 2
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, texCoords));
-    glEnableVertexAttribArray(2);
+void ConsoleScreen::setRenderBackend(std::unique_ptr<RenderBackend> backend)
+{
+    m_backend = std::move(backend);
+}
 
-    // Foreground VAO/VBO
-    glGenVertexArrays(1, &m_fg_vao);
-    glGenBuffers(1, &m_fg_vbo);
-    glBindVertexArray(m_fg_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, m_fg_vbo);
-    glBufferData(GL_ARRAY_BUFFER, buf_size, m_console_fg_vertices.data(), GL_STREAM_DRAW);
+RenderBackend &ConsoleScreen::renderBackend()
+{
+    return *m_backend;
+}
 
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, position));
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void *)offsetof(Vertex, color));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, texCoords));
-    glEnableVertexAttribArray(2);
+void ConsoleScreen::initBackend()
+{
+    if (!m_backend)
+        m_backend = std::make_unique<GLBackend>();
 
-    glBindVertexArray(0);
+    m_backend->create(Vec2u(m_width, m_height), Vec2u(m_character_width, m_character_height), m_atlas_width);
 
-    // Create initial atlas texture (small, will grow)
+    // Create initial atlas (small, will grow)
     m_atlas_tex_width  = m_atlas_width * m_character_width;
     m_atlas_tex_height = m_atlas_width * m_character_height;
+    m_atlas_pixels.assign(static_cast<size_t>(m_atlas_tex_width) * m_atlas_tex_height, 0);
 
-    glGenTextures(1, &m_atlas_texture);
-    glBindTexture(GL_TEXTURE_2D, m_atlas_texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_atlas_tex_width, m_atlas_tex_height,
-                 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    m_max_texture_size = m_backend->maxAtlasSize();
+
+    uploadAtlas();
 }
 
 const Vec2i ConsoleScreen::characterSize()
@@ -163,135 +135,181 @@ const Vec2i ConsoleScreen::size()
     return Vec2i(m_width, m_height);
 }
 
-inline void ConsoleScreen::setCellPositions(std::vector<Vertex> &vertices, const Vec2i &location,
-                                            float left, float top, float width, float height)
+const void ConsoleScreen::createPalette(const std::vector<Color> &palette_colors)
 {
-    auto offset = (location.x + location.y * m_width) * VERTS_PER_CELL;
+    if (palette_colors.size() > MAX_PALETTE_COLORS) {
+        SPDLOG_WARN("palette has {} colors, only the first {} will be used",
+                    palette_colors.size(),
+                    MAX_PALETTE_COLORS);
+    }
+
+    m_palette_colors.assign(palette_colors.begin(),
+                            palette_colors.begin() + std::min<size_t>(palette_colors.size(), MAX_PALETTE_COLORS));
+    m_palette_dirty = true;
+}
+
+const void ConsoleScreen::setPaletteColor(const uint32_t index, const Color &color)
+{
+    if (index >= MAX_PALETTE_COLORS) {
+        SPDLOG_WARN("palette index {} is out of range", index);
+        return;
+    }
 
-    Vec2f tl(left, top);
-    Vec2f tr(left + width, top);
-    Vec2f br(left + width, top + height);
-    Vec2f bl(left, top + height);
+    if (index >= m_palette_colors.size())
+        m_palette_colors.resize(index + 1, Color::Black);
 
-    // Triangle 1: top-left, top-right, bottom-right
-    vertices[offset + 0].position = tl;
-    vertices[offset + 1].position = tr;
-    vertices[offset + 2].position = br;
-    // Triangle 2: top-left, bottom-right, bottom-left
-    vertices[offset + 3].position = tl;
-    vertices[offset + 4].position = br;
-    vertices[offset + 5].position = bl;
+    m_palette_colors[index] = color;
+    m_palette_dirty         = true;
 }
 
-inline void ConsoleScreen::setCellColor(std::vector<Vertex> &vertices,
-                                        const Vec2i &location, const Color &color)
+const void ConsoleScreen::setForeground(const uint32_t color)
 {
-    auto offset = (location.x + location.y * m_width) * VERTS_PER_CELL;
+    m_current_fg = color;
+}
 
-    for (int i = 0; i < VERTS_PER_CELL; i++) {
-        vertices[offset + i].color = color;
-    }
+const void ConsoleScreen::setBackGround(const uint32_t color)
+{
+    m_current_bg = color;
 }
 
-inline void ConsoleScreen::setCellTexCoords(std::vector<Vertex> &vertices,
-                                            const Vec2i &location, const Vec2f &texCoords)
+const void ConsoleScreen::setLayerCount(const uint32_t count)
 {
-    auto offset = (location.x + location.y * m_width) * VERTS_PER_CELL;
+    if (count == 0) {
+        SPDLOG_WARN("the console needs at least one layer");
+        return;
+    }
+
+    // new layers start out see-through, so adding one changes nothing on screen.
+    m_layers.resize(count, std::vector<Cell>(m_width * m_height, SEE_THROUGH_CELL));
+    m_layer_visible.resize(count, 1);
 
-    // Normalized tex coords (0..1)
-    float u0 = texCoords.x;
-    float v0 = texCoords.y;
-    float u1 = texCoords.x + static_cast<float>(m_character_width) / m_atlas_tex_width;
-    float v1 = texCoords.y + static_cast<float>(m_character_height) / m_atlas_tex_height;
+    if (m_layer >= count)
+        m_layer = 0;
 
-    // Triangle 1
-    vertices[offset + 0].texCoords = {u0, v0};
-    vertices[offset + 1].texCoords = {u1, v0};
-    vertices[offset + 2].texCoords = {u1, v1};
-    // Triangle 2
-    vertices[offset + 3].texCoords = {u0, v0};
-    vertices[offset + 4].texCoords = {u1, v1};
-    vertices[offset + 5].texCoords = {u0, v1};
+    std::fill(m_touched_rows.begin(), m_touched_rows.end(), 1);
 }
 
-const void ConsoleScreen::createPalette(const std::vector<Color> &palette_colors)
+const void ConsoleScreen::setLayer(const uint32_t layer)
 {
-    m_palette_colors = palette_colors;
+    if (layer >= m_layers.size()) {
+        SPDLOG_WARN("layer {} does not exist, the console has {} layers", layer, m_layers.size());
+        return;
+    }
+
+    m_layer = layer;
 }
 
-const void ConsoleScreen::setForeground(const uint32_t color)
+const void ConsoleScreen::setLayerVisible(const uint32_t layer, const bool visible)
 {
-    m_current_fg = color;
+    if (layer >= m_layers.size()) {
+        SPDLOG_WARN("layer {} does not exist, the console has {} layers", layer, m_layers.size());
+        return;
+    }
+
+    if (m_layer_visible[layer] == visible)
+        return;
+
+    // the layers underneath are untouched; present() recomposites and uploads only what changed.
+    m_layer_visible[layer] = visible;
+    std::fill(m_touched_rows.begin(), m_touched_rows.end(), 1);
 }
 
-const void ConsoleScreen::setBackGround(const uint32_t color)
+uint32_t ConsoleScreen::layer()
 {
-    m_current_bg = color;
+    return m_layer;
 }
 
-const void ConsoleScreen::write(const Vec2i location, const std::string text, const uint32_t max_width,
+const void ConsoleScreen::write(const Vec2i location, const std::string_view text, const uint32_t max_width,
                                 const uint32_t fg, const uint32_t bg)
 {
-    std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t> cv;
-    auto str = cv.from_bytes(text);
+    if (location.y < 0 || location.y >= static_cast<int>(m_height) || location.x >= static_cast<int>(m_width))
+        return;
 
-    uint32_t offset = 0;
-    for (auto &c : str) {
-        if (offset == max_width)
-            break;
+    // characters that would land left of the console are decoded and dropped.
+    const int64_t limit = std::min<int64_t>(max_width, static_cast<int64_t>(m_width) - location.x);
+    const int64_t row   = static_cast<int64_t>(location.y) * m_width;
+    const auto fg_index = static_cast<uint8_t>(fg);
+    const auto bg_index = static_cast<uint8_t>(bg);
 
-        if (location.x + static_cast<int>(offset) >= static_cast<int>(m_width))
-            break;
+    auto &cells         = m_layers[m_layer];
 
-        poke(Vec2i(location.x + offset, location.y), c, fg, bg);
-        offset++;
+    auto put = [&](const int64_t column, const char32_t character) {
+        if (location.x + column < 0)
+            return;
+
+        cells[row + location.x + column] = Cell{character, fg_index, bg_index, Cell::NONE};
+    };
+
+    m_touched_rows[location.y] = 1;
+
+    int64_t column = 0;
+    size_t offset  = 0;
+
+    while (offset < text.size() && column < limit) {
+        // runs of ASCII map one byte to one cell, so skip the decoder for them. Only scan as far
+        // as there are cells left to fill.
+        const auto ascii = static_cast<int64_t>(utf8::asciiPrefix(text.substr(offset, limit - column)));
+        for (int64_t i = 0; i < ascii; i++)
+            put(column + i, static_cast<uint8_t>(text[offset + i]));
+
+        offset += ascii;
+        column += ascii;
+
+        if (offset < text.size() && column < limit)
+            put(column++, utf8::decode(text, offset));
     }
 }
 
 const void ConsoleScreen::clear()
 {
+    // layers above the base clear to see-through, so the layers under them show again.
+    if (m_layer > 0) {
+        std::fill(m_layers[m_layer].begin(), m_layers[m_layer].end(), SEE_THROUGH_CELL);
+        std::fill(m_touched_rows.begin(), m_touched_rows.end(), 1);
+        return;
+    }
+
     rectangle(IntRect(Vec2i{0, 0}, Vec2i{static_cast<int>(m_width), static_cast<int>(m_height)}), 32, 1);
 }
 
-const void ConsoleScreen::write(const Vec2i location, const std::string text, const uint32_t max_width,
+const void ConsoleScreen::write(const Vec2i location, const std::string_view text, const uint32_t max_width,
                                 const uint32_t fg)
 {
     write(location, text, max_width, fg, m_current_bg);
 }
 
-const void ConsoleScreen::write(const Vec2i location, const std::string text, const uint32_t max_width)
+const void ConsoleScreen::write(const Vec2i location, const std::string_view text, const uint32_t max_width)
 {
     write(location, text, max_width, m_current_fg, m_current_bg);
 }
 
-const void ConsoleScreen::write(const Vec2i location, const std::string text)
+const void ConsoleScreen::write(const Vec2i location, const std::string_view text)
 {
     uint32_t max_width = m_width - location.x;
     write(location, text, max_width, m_current_fg, m_current_bg);
 }
 
-const void ConsoleScreen::write(const uint32_t x, uint32_t y, const std::string text)
+const void ConsoleScreen::write(const uint32_t x, uint32_t y, const std::string_view text)
 {
     write(Vec2i(x, y), text);
 }
 
-const void ConsoleScreen::writeCenter(const IntRect bounds, const std::string text)
+const void ConsoleScreen::writeCenter(const IntRect bounds, const std::string_view text)
 {
-    auto offset = (bounds.size.x - static_cast<int>(text.length())) / 2;
+    auto offset = (bounds.size.x - static_cast<int>(utf8::length(text))) / 2;
     write(Vec2i(bounds.position.x + offset, bounds.position.y), text, static_cast<uint32_t>(bounds.size.x));
 }
 
 inline void ConsoleScreen::poke(const Vec2i location, const char32_t character, const uint32_t fg,
                                 const uint32_t bg)
 {
-    if (location.x > static_cast<int>(m_width) || location.y > static_cast<int>(m_height))
+    if (location.x < 0 || location.y < 0 || location.x >= static_cast<int>(m_width) ||
+        location.y >= static_cast<int>(m_height))
         return;
 
-    const auto offset       = location.x + location.y * m_width;
-    m_console[offset]       = character;
-    m_console_fg[offset]    = fg;
-    m_console_bg[offset]    = bg;
-    m_console_dirty[offset] = true;
+    m_layers[m_layer][location.x + location.y * m_width] = Cell{character, static_cast<uint8_t>(fg),
+                                                                static_cast<uint8_t>(bg), Cell::NONE};
+    m_touched_rows[location.y] = 1;
 }
 
 void ConsoleScreen::poke(const uint32_t x, uint32_t y, const char32_t character, const uint32_t fg, const uint32_t bg)
@@ -301,9 +319,80 @@ void ConsoleScreen::poke(const uint32_t x, uint32_t y, const char32_t character,
 
 inline const std::tuple<const char32_t, const uint32_t, const uint32_t> ConsoleScreen::peek(const Vec2i location)
 {
-    return std::make_tuple(m_console[location.x + location.y * m_width],
-                           m_console_fg[location.x + location.y * m_width],
-                           m_console_bg[location.x + location.y * m_width]);
+    const Cell &cell = m_layers[m_layer][location.x + location.y * m_width];
+    return std::make_tuple(cell.glyph, cell.fg, cell.bg);
+}
+
+const void ConsoleScreen::blit(const std::vector<char32_t> &glyphs, const std::vector<uint8_t> &fg,
+                               const std::vector<uint8_t> &bg, const Vec2i source_size, const IntRect view,
+                               const Vec2i destination)
+{
+    const size_t source_cells = static_cast<size_t>(std::max(source_size.x, 0)) * std::max(source_size.y, 0);
+    if (glyphs.size() < source_cells || fg.size() < source_cells || bg.size() < source_cells) {
+        SPDLOG_WARN("blit source planes are smaller than {}x{}", source_size.x, source_size.y);
+        return;
+    }
+
+    blitRows(glyphs.data(), fg.data(), bg.data(), source_size, view, destination);
+}
+
+const void ConsoleScreen::blit(const std::vector<char32_t> &glyphs, const Vec2i source_size, const IntRect view,
+                               const Vec2i destination)
+{
+    const size_t source_cells = static_cast<size_t>(std::max(source_size.x, 0)) * std::max(source_size.y, 0);
+    if (glyphs.size() < source_cells) {
+        SPDLOG_WARN("blit source glyphs are smaller than {}x{}", source_size.x, source_size.y);
+        return;
+    }
+
+    blitRows(glyphs.data(), nullptr, nullptr, source_size, view, destination);
+}
+
+// Clips the view against the source and the console, then packs each row of the source planes into
+// Cells. A null fg or bg plane fills with the current color instead.
+void ConsoleScreen::blitRows(const char32_t *glyphs, const uint8_t *fg, const uint8_t *bg, const Vec2i source_size,
+                             const IntRect view, const Vec2i destination)
+{
+    int left   = view.position.x;
+    int top    = view.position.y;
+    int right  = view.position.x + view.size.x;
+    int bottom = view.position.y + view.size.y;
+
+    // clip to the source grid.
+    left   = std::max(left, 0);
+    top    = std::max(top, 0);
+    right  = std::min(right, source_size.x);
+    bottom = std::min(bottom, source_size.y);
+
+    // clip to the console, in source coordinates.
+    const int dx = destination.x - view.position.x;
+    const int dy = destination.y - view.position.y;
+
+    left   = std::max(left, -dx);
+    top    = std::max(top, -dy);
+    right  = std::min(right, static_cast<int>(m_width) - dx);
+    bottom = std::min(bottom, static_cast<int>(m_height) - dy);
+
+    if (left >= right || top >= bottom)
+        return;
+
+    const size_t columns = right - left;
+
+    for (int y = top; y < bottom; y++) {
+        const size_t source = static_cast<size_t>(left) + static_cast<size_t>(y) * source_size.x;
+        const size_t target = static_cast<size_t>(left + dx) + static_cast<size_t>(y + dy) * m_width;
+
+        Cell *cells = &m_layers[m_layer][target];
+
+        for (size_t column = 0; column < columns; column++) {
+            cells[column] = Cell{glyphs[source + column],
+                                 fg ? fg[source + column] : static_cast<uint8_t>(m_current_fg),
+                                 bg ? bg[source + column] : static_cast<uint8_t>(m_current_bg),
+                                 Cell::NONE};
+        }
+
+        m_touched_rows[y + dy] = 1;
+    }
 }
 
 const void ConsoleScreen::rectangle(const IntRect bounds, const char32_t character, const bool filled)
@@ -317,7 +406,8 @@ const void ConsoleScreen::rectangle(const IntRect bounds, const char32_t charact
         return;
     }
 
-    if (bounds.position.x + bounds.size.x > static_cast<int>(m_width) ||
+    if (bounds.position.x < 0 || bounds.position.y < 0 ||
+        bounds.position.x + bounds.size.x > static_cast<int>(m_width) ||
         bounds.position.y + bounds.size.y > static_cast<int>(m_height)) {
         SPDLOG_WARN("given bounds ({},{} {}x{}) that would draw outside of console",
                     bounds.position.x,
@@ -327,20 +417,21 @@ const void ConsoleScreen::rectangle(const IntRect bounds, const char32_t charact
         return;
     }
 
+    const Cell cell{character, static_cast<uint8_t>(m_current_fg), static_cast<uint8_t>(m_current_bg), Cell::NONE};
+
+    // filled rows, and the top and bottom edges of an outline, are plain word fills.
+    auto fillRow = [&](const int y) {
+        std::fill_n(&m_layers[m_layer][bounds.position.x + y * m_width], bounds.size.x, cell);
+        m_touched_rows[y] = 1;
+    };
+
     if (filled) {
-        for (int y = bounds.position.y; y < bounds.position.y + bounds.size.y; y++) {
-            for (int x = bounds.position.x; x < bounds.position.x + bounds.size.x; x++) {
-                if (filled || x == bounds.position.x || x == bounds.position.x + bounds.size.x - 1 ||
-                    y == bounds.position.y || y == bounds.position.y + bounds.size.y - 1) {
-                    poke(Vec2i(x, y), character, m_current_fg, m_current_bg);
-                }
-            }
-        }
+        for (int y = bounds.position.y; y < bounds.position.y + bounds.size.y; y++)
+            fillRow(y);
     } else {
-        for (int x = bounds.position.x; x < bounds.position.x + bounds.size.x; x++) {
-            poke(Vec2i(x, bounds.position.y), character, m_current_fg, m_current_bg);
-            poke(Vec2i(x, bounds.position.y + bounds.size.y - 1), character, m_current_fg, m_current_bg);
-        }
+        fillRow(bounds.position.y);
+        fillRow(bounds.position.y + bounds.size.y - 1);
+
         for (int y = bounds.position.y + 1; y < bounds.position.y + bounds.size.y - 1; y++) {
             poke(Vec2i(bounds.position.x, y), character, m_current_fg, m_current_bg);
             poke(Vec2i(bounds.position.x + bounds.size.x - 1, y), character, m_current_fg, m_current_bg);
@@ -348,50 +439,50 @@ const void ConsoleScreen::rectangle(const IntRect bounds, const char32_t charact
     }
 }
 
-std::string wrap(const std::string text, size_t line_length = 72)
+std::string wrap(const std::string_view text, size_t line_length = 72)
 {
-    std::istringstream words(text);
+    std::istringstream words{std::string(text)};
     std::ostringstream wrapped;
     std::string word;
 
     if (words >> word) {
         wrapped << word;
-        size_t space_left = line_length - word.length();
+        size_t space_left = line_length - utf8::length(word);
         while (words >> word) {
-            if (space_left < word.length() + 1) {
+            const auto word_length = utf8::length(word);
+            if (space_left < word_length + 1) {
                 wrapped << '\n' << word;
-                space_left = line_length - word.length();
+                space_left = line_length - word_length;
             } else {
                 wrapped << ' ' << word;
-                space_left -= word.length() + 1;
+                space_left -= word_length + 1;
             }
         }
     }
     return wrapped.str();
 }
 
-const void ConsoleScreen::writeRectangle(const IntRect bounds, const std::string text)
+const void ConsoleScreen::writeRectangle(const IntRect bounds, const std::string_view text)
 {
     int x = bounds.position.x;
     int y = bounds.position.y;
 
-    auto wrapped = wrap(text, bounds.size.x);
-    auto it      = wrapped.begin();
+    const auto wrapped = wrap(text, bounds.size.x);
+    size_t offset      = 0;
 
-    while (it != wrapped.end()) {
-        if (*it == '\n') {
+    while (offset < wrapped.size()) {
+        if (wrapped[offset] == '\n') {
             x = bounds.position.x;
             y++;
-            it++;
+            offset++;
             continue;
         }
 
         if (y > bounds.position.y + bounds.size.y - 1)
             return;
 
-        poke(Vec2i(x, y), *it, m_current_fg, m_current_bg);
+        poke(Vec2i(x, y), utf8::decode(wrapped, offset), m_current_fg, m_current_bg);
         x++;
-        it++;
     }
 }
 
@@ -421,168 +512,525 @@ inline bool glyphBit(const FT_GlyphSlot &glyph, const int x, const int y)
     return (cValue & (128 >> (x & 7))) != 0;
 }
 
-const void ConsoleScreen::update()
+inline void ConsoleScreen::markDirty(const uint32_t x, const uint32_t y)
 {
-    std::vector<uint8_t> bitmap;
-    bool any_dirty = false;
+    m_dirty_bits[y * m_dirty_row_words + x / 64] |= uint64_t(1) << (x % 64);
+    m_dirty_rows[y] = 1;
+}
 
-    const uint32_t total = m_width * m_height;
+// Marks count cells starting at x, y dirty, setting whole words of the bitmap at a time.
+void ConsoleScreen::markDirty(uint32_t x, const uint32_t y, const uint32_t count)
+{
+    if (count == 0)
+        return;
 
-    for (uint32_t cell = 0; cell < total; cell++) {
-        if (!m_console_dirty[cell])
-            continue;
+    uint64_t *row       = &m_dirty_bits[y * m_dirty_row_words];
+    const uint32_t last = x + count;
 
-        any_dirty = true;
+    while (x < last) {
+        const uint32_t bit  = x % 64;
+        const uint32_t bits = std::min(64 - bit, last - x);
+        const uint64_t mask = bits == 64 ? ~uint64_t(0) : ((uint64_t(1) << bits) - 1) << bit;
 
-        const char32_t character = m_console[cell];
-        const auto fg_color      = m_palette_colors[m_console_fg[cell]];
-        const auto bg_color      = m_palette_colors[m_console_bg[cell]];
+        row[x / 64] |= mask;
+        x += bits;
+    }
 
-        uint32_t atlas_offset = 0;
-        auto atlas_offset_it  = m_console_atlas_offset.find(character);
+    m_dirty_rows[y] = 1;
+}
 
-        if (atlas_offset_it == m_console_atlas_offset.end()) {
-            bitmap.resize(m_character_width * m_character_height, 0);
+void ConsoleScreen::markAllDirty()
+{
+    for (uint32_t y = 0; y < m_height; y++)
+        markDirty(0, y, m_width);
+}
 
-            if (FT_Load_Char(m_face, character, FT_LOAD_RENDER | FT_LOAD_MONOCHROME | FT_LOAD_TARGET_MONO) !=
-                FT_Err_Ok) {
-                continue;
-            }
+// Composites the layers into the front buffer. Only rows drawn to in any layer since the last
+// present are composited and compared, and of those only cells whose contents actually changed are
+// marked dirty, so clearing and redrawing an unchanged screen every frame uploads nothing, and
+// hiding an overlay only uploads the cells it covered.
+const void ConsoleScreen::present()
+{
+    // with just the base layer showing there is nothing to composite; rows compare directly.
+    const bool base_only = baseLayerOnly();
 
-            FT_GlyphSlot glyph = m_face->glyph;
+    for (uint32_t y = 0; y < m_height; y++) {
+        if (!m_touched_rows[y])
+            continue;
 
-            for (size_t glyph_y = 0; glyph_y < glyph->bitmap.rows; ++glyph_y) {
-                for (size_t glyph_x = 0; glyph_x < glyph->bitmap.width; ++glyph_x) {
-                    int imageIndex = (glyph->bitmap.width * glyph_y) + glyph_x;
-                    bitmap[imageIndex] = glyphBit(glyph, glyph_x, glyph_y) ? 255 : 0;
-                }
-            }
+        m_touched_rows[y] = 0;
+
+        const size_t row = static_cast<size_t>(y) * m_width;
+        const Cell *composite;
+
+        if (base_only) {
+            composite = &m_layers[0][row];
+        } else {
+            std::fill(m_composite.begin(), m_composite.end(), BLANK_CELL);
+
+            for (size_t layer = 0; layer < m_layers.size(); layer++) {
+                if (!m_layer_visible[layer])
+                    continue;
 
-            // Build RGBA pixel buffer for this glyph
-            std::vector<uint8_t> rgba_pixels(m_character_width * m_character_height * 4, 0);
-
-            for (uint32_t offset_y = 0; offset_y < m_character_height; offset_y++) {
-                for (uint32_t offset_x = 0; offset_x < m_character_width; offset_x++) {
-                    if (bitmap[offset_x + offset_y * m_character_width] == 255) {
-                        size_t px = (offset_x + offset_y * m_character_width) * 4;
-                        rgba_pixels[px + 0] = 255;
-                        rgba_pixels[px + 1] = 255;
-                        rgba_pixels[px + 2] = 255;
-                        rgba_pixels[px + 3] = 255;
-                    }
+                const Cell *cells = &m_layers[layer][row];
+                for (uint32_t x = 0; x < m_width; x++) {
+                    if (!(cells[x].attributes & Cell::SEE_THROUGH))
+                        m_composite[x] = cells[x];
                 }
             }
 
-            atlas_offset = setAtlasGlyph(character, rgba_pixels);
-        } else {
-            atlas_offset = atlas_offset_it->second;
+            composite = m_composite.data();
+        }
+
+        if (std::memcmp(composite, &m_front[row], m_width * sizeof(Cell)) == 0)
+            continue;
+
+        for (uint32_t x = 0; x < m_width; x++) {
+            if (composite[x] == m_front[row + x])
+                continue;
+
+            m_front[row + x] = composite[x];
+            markDirty(x, y);
         }
+    }
+}
+
+bool ConsoleScreen::baseLayerOnly()
+{
+    return m_layer_visible[0] && std::count(m_layer_visible.begin(), m_layer_visible.end(), 1) == 1;
+}
+
+// Moves rows top to bottom (exclusive) of a grid with the given stride by dy rows, only touching
+// the columns from left. Rows are walked away from the direction of travel so each is read before
+// it is overwritten.
+template <typename T>
+void shiftRows(std::vector<T> &cells, const size_t stride, const int left, const int columns, const int top,
+               const int bottom, const int dy)
+{
+    const size_t bytes = columns * sizeof(T);
 
-        const int base = cell * VERTS_PER_CELL;
+    if (dy < 0) {
+        for (int y = top; y < bottom + dy; y++)
+            std::memmove(&cells[left + y * stride], &cells[left + (y - dy) * stride], bytes);
+    } else {
+        for (int y = bottom - 1; y >= top + dy; y--)
+            std::memmove(&cells[left + y * stride], &cells[left + (y - dy) * stride], bytes);
+    }
+}
+
+const void ConsoleScreen::scroll(const IntRect region, const int dy)
+{
+    const int left   = std::max(region.position.x, 0);
+    const int top    = std::max(region.position.y, 0);
+    const int right  = std::min(region.position.x + region.size.x, static_cast<int>(m_width));
+    const int bottom = std::min(region.position.y + region.size.y, static_cast<int>(m_height));
+
+    if (left >= right || top >= bottom || dy == 0)
+        return;
+
+    const int columns = right - left;
+    const int rows    = bottom - top;
+    const int shift   = std::clamp(dy, -rows, rows);
 
-        // Set background colors
-        for (int i = 0; i < VERTS_PER_CELL; i++)
-            m_console_bg_vertices[base + i].color = bg_color;
+    auto &cells = m_layers[m_layer];
 
-        // Set foreground colors
-        for (int i = 0; i < VERTS_PER_CELL; i++)
-            m_console_fg_vertices[base + i].color = fg_color;
+    shiftRows(cells, m_width, left, columns, top, bottom, shift);
 
-        // Set foreground tex coords — normalized to 0..1
-        const float tx = static_cast<float>((atlas_offset % m_atlas_width) * m_character_width) / m_atlas_tex_width;
-        const float ty = static_cast<float>((atlas_offset / m_atlas_width) * m_character_height) / m_atlas_tex_height;
-        const float tw = static_cast<float>(m_character_width) / m_atlas_tex_width;
-        const float th = static_cast<float>(m_character_height) / m_atlas_tex_height;
+    // when the front buffer is just this layer and nothing in the region is still waiting to be
+    // uploaded, the front buffer and the instances already on the GPU are moved along with it.
+    // present() then finds the moved rows unchanged and update() re-sends them as they are,
+    // without resolving a single glyph.
+    const bool move_instances =
+        m_layer == 0 && baseLayerOnly() && std::abs(shift) < rows &&
+        std::find(m_dirty_rows.begin() + top, m_dirty_rows.begin() + bottom, 1) == m_dirty_rows.begin() + bottom;
 
-        // Triangle 1: TL, TR, BR
-        m_console_fg_vertices[base + 0].texCoords = {tx, ty};
-        m_console_fg_vertices[base + 1].texCoords = {tx + tw, ty};
-        m_console_fg_vertices[base + 2].texCoords = {tx + tw, ty + th};
-        // Triangle 2: TL, BR, BL
-        m_console_fg_vertices[base + 3].texCoords = {tx, ty};
-        m_console_fg_vertices[base + 4].texCoords = {tx + tw, ty + th};
-        m_console_fg_vertices[base + 5].texCoords = {tx, ty + th};
+    if (move_instances) {
+        shiftRows(m_front, m_width, left, columns, top, bottom, shift);
+        shiftRows(m_cell_instances, m_width, left, columns, top, bottom, shift);
 
-        m_console_dirty[cell] = false;
+        const int moved_top = shift < 0 ? top : top + shift;
+        const int moved_end = shift < 0 ? bottom + shift : bottom;
+
+        for (int y = moved_top; y < moved_end; y++) {
+            const uint32_t first = left + y * m_width;
+
+            if (!m_moved_spans.empty() && m_moved_spans.back().first + m_moved_spans.back().second == first)
+                m_moved_spans.back().second += columns;
+            else
+                m_moved_spans.emplace_back(first, columns);
+        }
     }
 
-    if (any_dirty) {
-        const size_t buf_size = total * VERTS_PER_CELL * sizeof(Vertex);
+    // rows scrolled in are cleared the same way clear() would.
+    const Cell blank = m_layer > 0 ? SEE_THROUGH_CELL
+                                   : Cell{32, static_cast<uint8_t>(m_current_fg),
+                                          static_cast<uint8_t>(m_current_bg), Cell::NONE};
+
+    const int exposed_top = shift < 0 ? bottom + shift : top;
+    const int exposed_end = shift < 0 ? bottom : top + shift;
 
-        glBindBuffer(GL_ARRAY_BUFFER, m_bg_vbo);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, buf_size, m_console_bg_vertices.data());
+    for (int y = exposed_top; y < exposed_end; y++)
+        std::fill_n(&cells[left + y * m_width], columns, blank);
 
-        glBindBuffer(GL_ARRAY_BUFFER, m_fg_vbo);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, buf_size, m_console_fg_vertices.data());
+    std::fill(m_touched_rows.begin() + top, m_touched_rows.begin() + bottom, 1);
+}
+
+// Walks the dirty bitmap a 64 cell word at a time, skipping clean rows with a single test, so a
+// frame where nothing changed costs one byte compare per row.
+const void ConsoleScreen::update()
+{
+    m_dirty_spans.clear();
 
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    for (uint32_t y = 0; y < m_height; y++) {
+        if (!m_dirty_rows[y])
+            continue;
+
+        m_dirty_rows[y] = 0;
+
+        uint64_t *row = &m_dirty_bits[y * m_dirty_row_words];
+
+        for (uint32_t word = 0; word < m_dirty_row_words; word++) {
+            uint64_t bits = row[word];
+            row[word]     = 0;
+
+            while (bits) {
+                updateCell(y * m_width + word * 64 + std::countr_zero(bits));
+                bits &= bits - 1;
+            }
+        }
     }
+
+    // rows moved by scroll() already hold their instances and only need sending.
+    m_dirty_spans.insert(m_dirty_spans.end(), m_moved_spans.begin(), m_moved_spans.end());
+    m_moved_spans.clear();
+
+    size_t uploaded_bytes = uploadPalette();
+    uploaded_bytes += m_backend->uploadCells(m_cell_instances.data(), m_front.data(), m_dirty_spans);
+
+    Stats::record("upload_bytes", uploaded_bytes);
 }
 
-uint32_t ConsoleScreen::setAtlasGlyph(const char32_t charcode, const std::vector<uint8_t> &rgba_pixels)
+// Rebuilds the instance record for a dirty cell and adds it to the spans to upload.
+void ConsoleScreen::updateCell(const uint32_t cell)
 {
-    uint32_t atlas_capacity = (m_atlas_tex_width / m_character_width) * (m_atlas_tex_height / m_character_height);
+    // coalesce this cell into the previous span if the gap is small enough that uploading the
+    // clean cells in between is cheaper than issuing another upload call.
+    if (!m_dirty_spans.empty() &&
+        cell - (m_dirty_spans.back().first + m_dirty_spans.back().second) <= UPLOAD_COALESCE_CELLS) {
+        m_dirty_spans.back().second = cell - m_dirty_spans.back().first + 1;
+    } else {
+        m_dirty_spans.emplace_back(cell, 1);
+    }
+
+    const Cell &front        = m_front[cell];
+    const char32_t character = front.glyph;
+
+    uint32_t atlas_offset = 0;
+    auto atlas_offset_it  = m_console_atlas_offset.find(character);
 
-    if (m_glyph_count == atlas_capacity) {
-        // Read back old atlas pixels
-        uint32_t old_height = m_atlas_tex_height;
-        std::vector<uint8_t> old_pixels(m_atlas_tex_width * old_height * 4);
-        glBindTexture(GL_TEXTURE_2D, m_atlas_texture);
-        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, old_pixels.data());
+    if (atlas_offset_it == m_console_atlas_offset.end()) {
+        // a glyph that can't be rasterized draws as the first atlas slot, in the cell's colors.
+        atlas_offset = setAtlasGlyph(character).value_or(0);
+    } else {
+        atlas_offset = atlas_offset_it->second;
+    }
 
-        // Grow by 128 characters high
-        uint32_t new_height = old_height + m_atlas_width * m_character_height;
+    m_cell_instances[cell] = CellInstance{atlas_offset, front.fg, front.bg, 0};
+}
 
-        GLuint new_tex;
-        glGenTextures(1, &new_tex);
-        glBindTexture(GL_TEXTURE_2D, new_tex);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_atlas_tex_width, new_height,
-                     0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+size_t ConsoleScreen::uploadPalette()
+{
+    if (!m_palette_dirty)
+        return 0;
 
-        // Copy old data back
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_atlas_tex_width, old_height,
-                        GL_RGBA, GL_UNSIGNED_BYTE, old_pixels.data());
+    m_palette_dirty = false;
 
-        glDeleteTextures(1, &m_atlas_texture);
-        m_atlas_texture = new_tex;
-        m_atlas_tex_height = new_height;
+    return m_backend->uploadPalette(m_palette_colors);
+}
 
-        SPDLOG_INFO("grew the atlas to {}x{}", m_atlas_tex_width, m_atlas_tex_height);
+// Rasterizes a glyph into the next free slot of the atlas and uploads just that glyph.
+std::optional<uint32_t> ConsoleScreen::setAtlasGlyph(const char32_t charcode)
+{
+    if (!growAtlas(m_glyph_count + 1)) {
+        // out of texture space; draw it as whatever is in the first slot rather than retrying every frame.
+        m_console_atlas_offset[charcode] = 0;
+        return 0;
     }
 
-    uint32_t x = (m_glyph_count % m_atlas_width) * m_character_width;
-    uint32_t y = (m_glyph_count / m_atlas_width) * m_character_height;
+    const uint32_t x = (m_glyph_count % m_atlas_width) * m_character_width;
+    const uint32_t y = (m_glyph_count / m_atlas_width) * m_character_height;
+
+    uint8_t *glyph_pixels = &m_atlas_pixels[x + static_cast<size_t>(y) * m_atlas_tex_width];
+
+    if (!rasterizeGlyph(charcode, glyph_pixels, m_atlas_tex_width)) {
+        // remember the failure too, so the font isn't asked for it again every frame.
+        m_console_atlas_offset[charcode] = 0;
+        return std::nullopt;
+    }
 
-    glBindTexture(GL_TEXTURE_2D, m_atlas_texture);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, m_character_width, m_character_height,
-                    GL_RGBA, GL_UNSIGNED_BYTE, rgba_pixels.data());
-    glBindTexture(GL_TEXTURE_2D, 0);
+    // upload straight from the shadow copy, which has the full atlas row length.
+    m_backend->uploadAtlasRegion(glyph_pixels, m_atlas_tex_width, x, y, m_character_width, m_character_height);
 
     m_console_atlas_offset[charcode] = m_glyph_count;
-    auto rv = m_glyph_count;
-    m_glyph_count++;
-    return rv;
+    return m_glyph_count++;
 }
 
-inline Vec2f ConsoleScreen::getAtlasCoordsForOffset(const uint32_t &offset)
+// Makes sure the atlas has room for glyph_count glyphs, doubling its height as needed so that
+// growth happens rarely. Texture coordinates are derived from the atlas size in the shader, so
+// cells that are already drawn stay correct after the atlas grows.
+bool ConsoleScreen::growAtlas(const uint32_t glyph_count)
 {
-    float x = static_cast<float>((offset % m_atlas_width) * m_character_width) / m_atlas_tex_width;
-    float y = static_cast<float>((offset / m_atlas_width) * m_character_height) / m_atlas_tex_height;
+    const uint32_t rows       = (glyph_count + m_atlas_width - 1) / m_atlas_width;
+    const uint32_t min_height = rows * m_character_height;
+
+    if (min_height <= m_atlas_tex_height)
+        return true;
+
+    if (m_max_texture_size && min_height > m_max_texture_size) {
+        SPDLOG_ERROR("the atlas cannot hold {} glyphs within the maximum texture size of {}",
+                     glyph_count,
+                     m_max_texture_size);
+        return false;
+    }
+
+    uint32_t new_height = m_atlas_tex_height;
+    while (new_height < min_height)
+        new_height *= 2;
+
+    if (m_max_texture_size)
+        new_height = std::min(new_height, m_max_texture_size / m_character_height * m_character_height);
+
+    // the atlas is stored row major at a fixed width, so growing it only appends rows.
+    m_atlas_tex_height = new_height;
+    m_atlas_pixels.resize(static_cast<size_t>(m_atlas_tex_width) * m_atlas_tex_height, 0);
+
+    uploadAtlas();
 
-    return Vec2f(x, y);
+    SPDLOG_INFO("grew the atlas to {}x{}", m_atlas_tex_width, m_atlas_tex_height);
+    return true;
 }
 
-void ConsoleScreen::loadFont(const std::string font_file, uint32_t pixel_size)
+// Rasterizes a glyph as one byte of coverage per pixel into a buffer with the given stride in
+// pixels, which may be a single glyph or a whole atlas image.
+bool ConsoleScreen::rasterizeGlyph(const char32_t charcode, uint8_t *coverage, const size_t stride)
 {
-    auto font_data = FileCache::Get(font_file);
+    // only try loading the font once; if that failed there is nothing to rasterize with.
+    if (!m_font_load_attempted) {
+        m_font_load_attempted = true;
+        loadFont(m_font_file, m_character_height);
+    }
+
+    if (!m_face)
+        return false;
 
+    if (FT_Load_Char(m_face, charcode, FT_LOAD_RENDER | FT_LOAD_MONOCHROME | FT_LOAD_TARGET_MONO) != FT_Err_Ok)
+        return false;
+
+    const FT_GlyphSlot glyph = m_face->glyph;
+    const uint32_t rows      = std::min<uint32_t>(glyph->bitmap.rows, m_character_height);
+    const uint32_t columns   = std::min<uint32_t>(glyph->bitmap.width, m_character_width);
+
+    for (uint32_t glyph_y = 0; glyph_y < rows; glyph_y++) {
+        for (uint32_t glyph_x = 0; glyph_x < columns; glyph_x++) {
+            if (glyphBit(glyph, glyph_x, glyph_y))
+                coverage[glyph_x + glyph_y * stride] = 255;
+        }
+    }
+
+    return true;
+}
+
+// Rasterizes every glyph in the given ranges into a CPU side atlas image and uploads it with a
+// single call, instead of one upload per glyph as they first appear on screen.
+void ConsoleScreen::bakeAtlas(const std::vector<GlyphRange> &ranges)
+{
+    std::filesystem::path cache_path;
+
+    if (!m_atlas_cache_directory.empty()) {
+        cache_path = atlasCachePath(ranges);
+        if (loadAtlasCache(cache_path))
+            return;
+    }
+
+    std::vector<char32_t> charcodes;
+    for (auto &range : ranges) {
+        for (char32_t c = range.first; c <= range.last; c++) {
+            if (m_console_atlas_offset.find(c) == m_console_atlas_offset.end())
+                charcodes.push_back(c);
+        }
+    }
+
+    // size the atlas for every glyph we've been asked for, even if the font lacks some of them.
+    if (!growAtlas(m_glyph_count + charcodes.size()))
+        return;
+
+    for (auto charcode : charcodes) {
+        const uint32_t x = (m_glyph_count % m_atlas_width) * m_character_width;
+        const uint32_t y = (m_glyph_count / m_atlas_width) * m_character_height;
+
+        if (!rasterizeGlyph(charcode, &m_atlas_pixels[x + static_cast<size_t>(y) * m_atlas_tex_width],
+                            m_atlas_tex_width))
+            continue;
+
+        m_console_atlas_offset[charcode] = m_glyph_count;
+        m_glyph_count++;
+    }
+
+    uploadAtlas();
+
+    SPDLOG_INFO("baked {} glyphs into the atlas", m_glyph_count);
+
+    if (!cache_path.empty())
+        saveAtlasCache(cache_path);
+}
+
+// Replaces the whole atlas on the backend with the shadow copy.
+void ConsoleScreen::uploadAtlas()
+{
+    m_backend->uploadAtlas(m_atlas_pixels.data(), m_atlas_tex_width, m_atlas_tex_height);
+}
+
+// FNV-1a, which is plenty to tell font files apart.
+static uint64_t hashBytes(const void *data, const size_t size, uint64_t hash = 0xcbf29ce484222325)
+{
+    const auto bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+std::filesystem::path ConsoleScreen::atlasCachePath(const std::vector<GlyphRange> &ranges)
+{
+    auto font_data = FileCache::Get(m_font_file);
+    if (!font_data)
+        return {};
+
+    const auto font_hash  = hashBytes(font_data->data(), font_data->size());
+    const auto range_hash = hashBytes(ranges.data(), ranges.size() * sizeof(GlyphRange));
+
+    return m_atlas_cache_directory /
+           fmt::format("{:016x}-{}x{}-{:016x}.atlas", font_hash, m_character_width, m_character_height, range_hash);
+}
+
+// The cache is a local file written by this machine, so it is stored in native byte order.
+struct AtlasCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t character_width;
+    uint32_t character_height;
+    uint32_t atlas_width;
+    uint32_t tex_width;
+    uint32_t tex_height;
+    uint32_t glyph_count;
+};
+
+static constexpr char kAtlasCacheMagic[4]    = {'G', 'E', 'A', 'T'};
+static constexpr uint32_t kAtlasCacheVersion = 2;
+
+bool ConsoleScreen::loadAtlasCache(const std::filesystem::path &path)
+{
+    if (path.empty() || !std::filesystem::exists(path))
+        return false;
+
+    try {
+        std::ifstream ifs(path, std::ios::binary);
+        ifs.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+        AtlasCacheHeader header;
+        ifs.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+        if (!std::equal(std::begin(kAtlasCacheMagic), std::end(kAtlasCacheMagic), header.magic) ||
+            header.version != kAtlasCacheVersion || header.character_width != m_character_width ||
+            header.character_height != m_character_height || header.atlas_width != m_atlas_width ||
+            header.tex_width != m_atlas_tex_width) {
+            SPDLOG_WARN("ignoring stale atlas cache {}", path.string());
+            return false;
+        }
+
+        // the sizes come from the file, so check them before allocating anything with them: the
+        // atlas has to fit the backend, the glyphs have to fit the atlas and the file has to be
+        // exactly as long as the header says.
+        const uint64_t pixel_bytes    = static_cast<uint64_t>(header.tex_width) * header.tex_height;
+        const uint64_t expected_size  = sizeof(header) + header.glyph_count * uint64_t{sizeof(char32_t)} + pixel_bytes;
+        const uint64_t glyph_capacity = static_cast<uint64_t>(header.tex_height / m_character_height) * m_atlas_width;
+
+        if ((m_max_texture_size && header.tex_height > m_max_texture_size) || header.glyph_count > glyph_capacity ||
+            std::filesystem::file_size(path) != expected_size) {
+            SPDLOG_WARN("ignoring corrupt atlas cache {}", path.string());
+            return false;
+        }
+
+        std::vector<char32_t> charcodes(header.glyph_count);
+        ifs.read(reinterpret_cast<char *>(charcodes.data()), charcodes.size() * sizeof(char32_t));
+
+        std::vector<uint8_t> pixels(static_cast<size_t>(header.tex_width) * header.tex_height);
+        ifs.read(reinterpret_cast<char *>(pixels.data()), pixels.size());
+
+        m_console_atlas_offset.clear();
+        for (uint32_t offset = 0; offset < charcodes.size(); offset++)
+            m_console_atlas_offset[charcodes[offset]] = offset;
+        m_glyph_count = header.glyph_count;
+
+        m_atlas_tex_height = header.tex_height;
+        m_atlas_pixels     = std::move(pixels);
+        uploadAtlas();
+
+        SPDLOG_INFO("loaded {} glyphs from atlas cache {}", m_glyph_count, path.string());
+        return true;
+    } catch (std::system_error &e) {
+        SPDLOG_WARN("unable to read atlas cache {}: {}", path.string(), e.code().message());
+    }
+
+    return false;
+}
+
+void ConsoleScreen::saveAtlasCache(const std::filesystem::path &path)
+{
+    // glyphs are stored in atlas offset order so the offsets don't need saving.
+    std::vector<char32_t> charcodes(m_glyph_count);
+    for (auto &[charcode, offset] : m_console_atlas_offset)
+        charcodes[offset] = charcode;
+
+    AtlasCacheHeader header{{},
+                            kAtlasCacheVersion,
+                            m_character_width,
+                            m_character_height,
+                            m_atlas_width,
+                            m_atlas_tex_width,
+                            m_atlas_tex_height,
+                            m_glyph_count};
+    std::copy(std::begin(kAtlasCacheMagic), std::end(kAtlasCacheMagic), header.magic);
+
+    try {
+        std::filesystem::create_directories(path.parent_path());
+
+        std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+        ofs.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+
+        ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        ofs.write(reinterpret_cast<const char *>(charcodes.data()), charcodes.size() * sizeof(char32_t));
+        ofs.write(reinterpret_cast<const char *>(m_atlas_pixels.data()), m_atlas_pixels.size());
+
+        SPDLOG_INFO("saved atlas cache {}", path.string());
+    } catch (std::system_error &e) {
+        SPDLOG_WARN("unable to write atlas cache {}: {}", path.string(), e.code().message());
+    }
+}
+
+void ConsoleScreen::loadFont(const std::string font_file, uint32_t pixel_size)
+{
     auto error = FT_Init_FreeType(&m_library);
     if (error != FT_Err_Ok) {
         SPDLOG_ERROR("unable to initialize freetype");
+        m_library = nullptr;
+        return;
+    }
+
+    auto font_data = FileCache::Get(font_file);
+    if (!font_data) {
+        SPDLOG_ERROR("unable to load font {}", font_file);
         return;
     }
 
@@ -608,35 +1056,7 @@ void ConsoleScreen::loadFont(const std::string font_file, uint32_t pixel_size)
 
 void ConsoleScreen::render(const glm::mat4 &projection, const glm::mat4 &model)
 {
-    static ShaderProgram shader;
-    static bool shader_compiled = false;
-
-    if (!shader_compiled) {
-        shader.compile(shaders::kVertexSource, shaders::kFragmentSource);
-        shader_compiled = true;
-    }
-
-    shader.use();
-    shader.setMat4("uProjection", projection);
-    shader.setMat4("uModel", model);
-
-    const uint32_t vertex_count = m_width * m_height * VERTS_PER_CELL;
-
-    // Pass 1: background (no texture)
-    shader.setBool("uUseTexture", false);
-    glBindVertexArray(m_bg_vao);
-    glDrawArrays(GL_TRIANGLES, 0, vertex_count);
-
-    // Pass 2: foreground (with atlas texture)
-    shader.setBool("uUseTexture", true);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_atlas_texture);
-    shader.setInt("uAtlas", 0);
-    glBindVertexArray(m_fg_vao);
-    glDrawArrays(GL_TRIANGLES, 0, vertex_count);
-
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    m_backend->render(projection, model);
 }
 
 const void ConsoleScreen::crash()
@@ -645,11 +1065,13 @@ const void ConsoleScreen::crash()
     const uint32_t total    = m_width * m_height;
 
     for (uint32_t cell = 0; cell < total; cell++) {
-        m_console[cell]    = 33 + m_rng() % 128;
-        m_console_fg[cell] = m_rng() % palette_size;
-        m_console_bg[cell] = m_rng() % palette_size;
-        m_console_dirty[cell] = true;
+        m_layers[m_layer][cell] = Cell{static_cast<char32_t>(33 + m_rng() % 128),
+                               static_cast<uint8_t>(m_rng() % palette_size),
+                               static_cast<uint8_t>(m_rng() % palette_size),
+                               Cell::NONE};
     }
+
+    std::fill(m_touched_rows.begin(), m_touched_rows.end(), 1);
 }
 
 const void ConsoleScreen::loading()
@@ -657,15 +1079,11 @@ const void ConsoleScreen::loading()
     const auto palette_size = static_cast<uint32_t>(m_palette_colors.size());
 
     for (uint32_t y = 0; y < m_height; y++) {
-        uint32_t bg_color = m_rng() % palette_size;
-        for (uint32_t x = 0; x < m_width; x++) {
-            const uint32_t cell    = x + y * m_width;
-            m_console[cell]        = 32;
-            m_console_fg[cell]     = 0;
-            m_console_bg[cell]     = bg_color;
-            m_console_dirty[cell]  = true;
-        }
+        const auto bg_color = static_cast<uint8_t>(m_rng() % palette_size);
+        std::fill_n(&m_layers[m_layer][y * m_width], m_width, Cell{32, 0, bg_color, Cell::NONE});
     }
+
+    std::fill(m_touched_rows.begin(), m_touched_rows.end(), 1);
 }
 
 std::vector<Color> ConsoleScreen::palette()
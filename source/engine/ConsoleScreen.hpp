@@ -25,29 +25,33 @@
 #pragma once
 
 #include <bitset>
+#include <filesystem>
 #include <memory>
+#include <optional>
 #include <random>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
-#include <glad/glad.h>
 #include <glm/mat4x4.hpp>
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include FT_BITMAP_H
 
 #include "Drawable.hpp"
+#include "RenderBackend.hpp"
 #include "Types.hpp"
 
 namespace ge
 {
 
-struct Vertex {
-    Vec2f position;  // 8 bytes
-    Color color;     // 4 bytes
-    Vec2f texCoords; // 8 bytes
+// An inclusive range of codepoints to rasterize into the glyph atlas up front.
+struct GlyphRange {
+    char32_t first;
+    char32_t last;
 };
 
 struct FontInfo {
@@ -59,41 +63,81 @@ struct FontInfo {
 class ConsoleScreen : public Drawable
 {
   public:
+    // printable ASCII plus the box drawing and block element ranges.
+    static inline const std::vector<GlyphRange> DEFAULT_GLYPH_RANGES = {{0x20, 0x7e}, {0x2500, 0x259f}};
+
     ConsoleScreen();
     virtual ~ConsoleScreen();
 
+    // the glyphs in preload_glyphs are rasterized and uploaded to the atlas in one go, so they never
+    // cause a hitch the first time they are drawn. Anything else is still rasterized on first use.
     const void create(uint32_t width, uint32_t height, std::string font_file, uint32_t font_width,
-                      uint32_t font_height);
+                      uint32_t font_height, const std::vector<GlyphRange> &preload_glyphs = DEFAULT_GLYPH_RANGES);
+
+    // when set before create(), the baked atlas is saved to this directory and loaded back on the
+    // next start with the same font, size and preload ranges, skipping FreeType entirely.
+    void setAtlasCacheDirectory(const std::filesystem::path &directory);
+
+    // when set before create(), the console draws through this backend instead of OpenGL.
+    void setRenderBackend(std::unique_ptr<RenderBackend> backend);
+    RenderBackend &renderBackend();
 
     const Vec2i characterSize();
     const Vec2i size();
 
+    // palette changes only upload the palette itself; no cells need to be rewritten.
     const void createPalette(const std::vector<Color> &palette_colors);
+    const void setPaletteColor(uint32_t index, const Color &color);
     std::vector<Color> palette();
 
+    // The console is a stack of layers composited by present(). Layer 0 is the base; each layer
+    // above it shows through wherever its cells are Cell::SEE_THROUGH, which is what clear() fills
+    // them with. Drawing and peek() use the current layer, layer 0 unless set otherwise.
+    const void setLayerCount(uint32_t count);
+    const void setLayer(uint32_t layer);
+    const void setLayerVisible(uint32_t layer, bool visible);
+    uint32_t layer();
+
     const void setForeground(uint32_t color);
     const void setBackGround(uint32_t color);
 
-    const void write(Vec2i location, std::string text, uint32_t max_width, uint32_t fg, uint32_t bg);
-    const void write(Vec2i location, std::string text, uint32_t max_width, uint32_t fg);
-    const void write(Vec2i location, std::string text, uint32_t max_width);
-    const void write(Vec2i location, std::string text);
-    const void write(uint32_t x, uint32_t y, std::string text);
+    // text is UTF-8; it is decoded straight into the console without any intermediate copies.
+    const void write(Vec2i location, std::string_view text, uint32_t max_width, uint32_t fg, uint32_t bg);
+    const void write(Vec2i location, std::string_view text, uint32_t max_width, uint32_t fg);
+    const void write(Vec2i location, std::string_view text, uint32_t max_width);
+    const void write(Vec2i location, std::string_view text);
+    const void write(uint32_t x, uint32_t y, std::string_view text);
 
-    const void writeCenter(IntRect, std::string);
-    const void writeRectangle(IntRect, std::string text);
+    const void writeCenter(IntRect, std::string_view);
+    const void writeRectangle(IntRect, std::string_view text);
 
     void poke(Vec2i location, char32_t character, uint32_t fg, uint32_t bg);
     void poke(uint32_t, uint32_t, char32_t character, uint32_t fg, uint32_t bg);
 
     const std::tuple<const char32_t, const uint32_t, const uint32_t> peek(Vec2i location);
 
+    // Copies the view rectangle of a source_size grid of glyphs and palette indices (such as the
+    // output of TileMap::render) to destination on the console, a row at a time. view.position is
+    // the camera offset into the source; anything outside either grid is clipped. The overload
+    // without index planes draws with the current foreground and background.
+    const void blit(const std::vector<char32_t> &glyphs, const std::vector<uint8_t> &fg,
+                    const std::vector<uint8_t> &bg, Vec2i source_size, IntRect view, Vec2i destination);
+    const void blit(const std::vector<char32_t> &glyphs, Vec2i source_size, IntRect view, Vec2i destination);
+
     const void rectangle(IntRect bounds, char32_t character, bool filled);
 
+    // Moves the cells inside region on the current layer by dy rows, up for negative dy, and clears
+    // the rows scrolled in the way clear() would. Where possible the cells already on the GPU are
+    // moved too, so a scrolling log pane is re-sent rather than rebuilt.
+    const void scroll(IntRect region, int dy);
+
     const void displayCharacterCodes(Vec2i location, char32_t start);
 
     const void clear();
 
+    // all drawing goes to a back buffer; present() commits it to the front buffer that is
+    // rendered, marking only the cells that changed since the last present.
+    const void present();
     const void update();
 
     void render(const glm::mat4 &projection, const glm::mat4 &model);
@@ -102,21 +146,32 @@ class ConsoleScreen : public Drawable
     const void loading();
 
   private:
-    static constexpr int VERTS_PER_CELL = 6;
-
-    void loadFont(std::string font_file, uint32_t pixel_size);
-    void initGL();
-
-    void setCellPositions(std::vector<Vertex> &vertices, const Vec2i &location,
-                          float left, float top, float width, float height);
-
-    void setCellColor(std::vector<Vertex> &, const Vec2i &, const Color &);
-
-    void setCellTexCoords(std::vector<Vertex> &, const Vec2i &, const Vec2f &);
+    // dirty cells closer together than this are uploaded as a single span.
+    static constexpr uint32_t UPLOAD_COALESCE_CELLS = 16;
 
-    uint32_t setAtlasGlyph(char32_t charcode, const std::vector<uint8_t> &rgba_pixels);
+    // what a cleared overlay layer holds, and what shows where no visible layer is opaque.
+    static constexpr Cell SEE_THROUGH_CELL{32, 0, 0, Cell::SEE_THROUGH};
+    static constexpr Cell BLANK_CELL{32, 0, 0, Cell::NONE};
 
-    Vec2f getAtlasCoordsForOffset(const uint32_t &);
+    void loadFont(std::string font_file, uint32_t pixel_size);
+    bool rasterizeGlyph(char32_t charcode, uint8_t *coverage, size_t stride);
+    void bakeAtlas(const std::vector<GlyphRange> &ranges);
+    bool growAtlas(uint32_t glyph_count);
+    void uploadAtlas();
+    std::filesystem::path atlasCachePath(const std::vector<GlyphRange> &ranges);
+    bool loadAtlasCache(const std::filesystem::path &path);
+    void saveAtlasCache(const std::filesystem::path &path);
+    void initBackend();
+    void blitRows(const char32_t *glyphs, const uint8_t *fg, const uint8_t *bg, Vec2i source_size, IntRect view,
+                  Vec2i destination);
+    void markDirty(uint32_t x, uint32_t y);
+    void markDirty(uint32_t x, uint32_t y, uint32_t count);
+    void markAllDirty();
+    bool baseLayerOnly();
+    void updateCell(uint32_t cell);
+    size_t uploadPalette();
+
+    std::optional<uint32_t> setAtlasGlyph(char32_t charcode);
 
     uint32_t m_width;
     uint32_t m_height;
@@ -127,24 +182,54 @@ class ConsoleScreen : public Drawable
     uint32_t m_glyph_count = 0;
     uint32_t m_atlas_width = 128; // in characters
 
-    FT_Library m_library;
-    FT_Face m_face;
+    std::string m_font_file;
+    std::filesystem::path m_atlas_cache_directory;
+
+    // FreeType is only loaded once a glyph actually needs rasterizing, and only tried the once.
+    FT_Library m_library       = nullptr;
+    FT_Face m_face             = nullptr;
+    bool m_font_load_attempted = false;
 
     std::vector<Color> m_palette_colors;
+    bool m_palette_dirty = true;
+
+    // one bit per cell, each row padded to whole 64 bit words, plus a flag per row so that clean
+    // rows are skipped without looking at their words.
+    std::vector<uint64_t> m_dirty_bits;
+    std::vector<uint8_t> m_dirty_rows;
+    uint32_t m_dirty_row_words = 0;
+
+    // back buffer, one plane of cells per layer, drawn into by everything above and read by peek().
+    std::vector<std::vector<Cell>> m_layers;
+    std::vector<uint8_t> m_layer_visible;
+    uint32_t m_layer = 0;
+
+    // rows written in any layer since the last present().
+    std::vector<uint8_t> m_touched_rows;
 
-    std::vector<bool> m_console_dirty;
-    std::vector<uint8_t> m_console_fg;
-    std::vector<uint8_t> m_console_bg;
-    std::vector<char32_t> m_console;
+    // scratch row the visible layers are composited into.
+    std::vector<Cell> m_composite;
 
-    std::vector<Vertex> m_console_bg_vertices;
-    std::vector<Vertex> m_console_fg_vertices;
+    // front buffer, what is currently on the GPU.
+    std::vector<Cell> m_front;
+
+    std::vector<CellInstance> m_cell_instances;
+
+    // spans of cells (first cell, cell count) that changed this frame and need uploading.
+    CellSpans m_dirty_spans;
+
+    // spans of instances moved by scroll() since the last update().
+    CellSpans m_moved_spans;
+
+    std::unique_ptr<RenderBackend> m_backend;
 
-    GLuint m_bg_vao = 0, m_bg_vbo = 0;
-    GLuint m_fg_vao = 0, m_fg_vbo = 0;
-    GLuint m_atlas_texture = 0;
     uint32_t m_atlas_tex_width = 0;
     uint32_t m_atlas_tex_height = 0;
+    uint32_t m_max_texture_size = 0;
+
+    // CPU copy of the atlas texture, one byte of coverage per pixel; growing the atlas re-uploads
+    // this rather than reading the texture back from the GPU.
+    std::vector<uint8_t> m_atlas_pixels;
 
     std::unordered_map<char32_t, uint32_t> m_console_atlas_offset;
     std::mt19937 m_rng{std::random_device{}()};
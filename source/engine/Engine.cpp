@@ -27,16 +27,21 @@
 #include <spdlog/sinks/rotating_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 
+#include <chrono>
+#include <iostream>
 #include <memory>
 #include <random>
+#include <thread>
 
 #include <math.h> /* ceil */
 
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "FileCache.hpp"
+#include "HeadlessBackend.hpp"
 #include "State.hpp"
 #include "Stats.hpp"
+#include "TerminalBackend.hpp"
 
 namespace ge
 {
@@ -44,7 +49,8 @@ namespace ge
 Engine::Engine()
 {
     std::vector<spdlog::sink_ptr> sinks;
-    sinks.push_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+    m_stdout_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+    sinks.push_back(m_stdout_sink);
     sinks.push_back(std::make_shared<spdlog::sinks::rotating_file_sink_mt>("gridrunner.log", 1000000, 5, true));
     console = std::make_shared<spdlog::logger>("console", begin(sinks), end(sinks));
 
@@ -71,7 +77,7 @@ void Engine::create()
 void Engine::create(uint32_t window_width, uint32_t window_height,
                     std::unique_ptr<ConsoleScreen> console_screen,
                     const std::string &font_file, uint32_t font_width, uint32_t font_height,
-                    const std::string &title)
+                    const std::string &title, const Backend backend)
 {
     SPDLOG_INFO("creating engine");
 
@@ -80,42 +86,8 @@ void Engine::create(uint32_t window_width, uint32_t window_height,
     m_font_width    = font_width;
     m_font_height   = font_height;
 
-    // Initialize GLFW
-    if (!glfwInit()) {
-        SPDLOG_ERROR("failed to initialize GLFW");
-        return;
-    }
-
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
-
-    m_window = glfwCreateWindow(m_window_width, m_window_height, title.c_str(), nullptr, nullptr);
-    if (!m_window) {
-        SPDLOG_ERROR("failed to create GLFW window");
-        glfwTerminate();
-        return;
-    }
-
-    glfwMakeContextCurrent(m_window);
-
-    // Initialize GLAD — must be after glfwMakeContextCurrent
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        SPDLOG_ERROR("failed to initialize GLAD");
-        glfwDestroyWindow(m_window);
-        glfwTerminate();
-        m_window = nullptr;
+    if (backend == Backend::OPENGL && !createWindow(title))
         return;
-    }
-
-    glfwSwapInterval(1); // vsync
-
-    // Install input callbacks
-    m_input_queue.install(m_window);
 
     // compute grid dimensions from window size — only whole cells
     m_screen_width  = m_window_width / m_font_width;
@@ -127,8 +99,21 @@ void Engine::create(uint32_t window_width, uint32_t window_height,
 
     // create the console screen with the computed dimensions
     m_screen = std::move(console_screen);
+    if (backend == Backend::HEADLESS)
+        m_screen->setRenderBackend(std::make_unique<HeadlessBackend>());
+
+    if (backend == Backend::TERMINAL) {
+        // log lines on stdout would land in the middle of the console.
+        std::erase(console->sinks(), m_stdout_sink);
+        m_screen->setRenderBackend(std::make_unique<TerminalBackend>(std::cout));
+    }
+
     m_screen->create(m_screen_width, m_screen_height, font_file, font_width, font_height);
 
+    // the debug overlay gets a layer of its own, so toggling it never touches the game's cells.
+    m_screen->setLayerCount(OVERLAY_LAYER + 1);
+    m_screen->setLayerVisible(OVERLAY_LAYER, m_fps_overlay);
+
     m_script_engine = std::make_unique<ScriptEngine>();
     m_state_stack   = std::make_unique<StateStack>();
     m_state         = std::make_shared<State>();
@@ -156,6 +141,49 @@ void Engine::create(uint32_t window_width, uint32_t window_height,
     m_screen->setForeground(1);
     m_screen->clear();
 
+    SPDLOG_INFO("engine created");
+}
+
+// Opens the window and its GL context; only the OpenGL backend needs one.
+bool Engine::createWindow(const std::string &title)
+{
+    // Initialize GLFW
+    if (!glfwInit()) {
+        SPDLOG_ERROR("failed to initialize GLFW");
+        return false;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    m_window = glfwCreateWindow(m_window_width, m_window_height, title.c_str(), nullptr, nullptr);
+    if (!m_window) {
+        SPDLOG_ERROR("failed to create GLFW window");
+        glfwTerminate();
+        return false;
+    }
+
+    glfwMakeContextCurrent(m_window);
+
+    // Initialize GLAD — must be after glfwMakeContextCurrent
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        SPDLOG_ERROR("failed to initialize GLAD");
+        glfwDestroyWindow(m_window);
+        glfwTerminate();
+        m_window = nullptr;
+        return false;
+    }
+
+    glfwSwapInterval(1); // vsync
+
+    // Install input callbacks
+    m_input_queue.install(m_window);
+
     // Set viewport to framebuffer size (may differ from window size on HiDPI/Wayland)
     int fb_width, fb_height;
     glfwGetFramebufferSize(m_window, &fb_width, &fb_height);
@@ -163,11 +191,10 @@ void Engine::create(uint32_t window_width, uint32_t window_height,
 
     SPDLOG_INFO("framebuffer size: {}x{} (window: {}x{})", fb_width, fb_height, m_window_width, m_window_height);
 
-    // Enable blending for glyph transparency
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    // The console resolves glyph and background in a single pass, so nothing needs blending.
+    glDisable(GL_BLEND);
 
-    SPDLOG_INFO("engine created");
+    return true;
 }
 
 void Engine::start()
@@ -176,9 +203,14 @@ void Engine::start()
 
     Stats::begin("frame_time");
 
-    while (!glfwWindowShouldClose(m_window)) {
+    m_running = true;
+
+    auto next_frame = std::chrono::steady_clock::now();
+
+    while (m_running && !(m_window && glfwWindowShouldClose(m_window))) {
         Stats::begin("process_event");
-        glfwPollEvents();
+        if (m_window)
+            glfwPollEvents();
         while (auto event = m_input_queue.poll()) {
             m_state_stack->ProcessEvent(*event);
         }
@@ -191,12 +223,21 @@ void Engine::start()
 
         // render the things.
         Stats::begin("render_time");
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+        if (m_window) {
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
         render();
         Stats::end("render_time");
 
-        glfwSwapBuffers(m_window);
+        if (m_window) {
+            glfwSwapBuffers(m_window);
+        } else if (m_frame_rate_limit) {
+            // a frame that ran long isn't made up for by hurrying the ones after it.
+            next_frame += std::chrono::microseconds(1000000 / m_frame_rate_limit);
+            next_frame = std::max(next_frame, std::chrono::steady_clock::now());
+            std::this_thread::sleep_until(next_frame);
+        }
         Stats::end("frame_time");
         Stats::begin("frame_time");
 
@@ -208,6 +249,16 @@ void Engine::start()
     m_screen.reset();
 }
 
+void Engine::stop()
+{
+    m_running = false;
+}
+
+void Engine::setFrameRateLimit(const uint32_t frames_per_second)
+{
+    m_frame_rate_limit = frames_per_second;
+}
+
 void Engine::renderDebugScreen()
 {
 
@@ -222,13 +273,22 @@ void Engine::renderDebugScreen()
     }
 
     if (m_fps_overlay) {
-        int oy = static_cast<int>(m_screen_height) - 6;
-        m_screen->rectangle(IntRect(Vec2i{1, oy}, Vec2i{22, 5}), 32, 1);
+        const auto layer = m_screen->layer();
+        m_screen->setLayer(OVERLAY_LAYER);
+
+        int oy = static_cast<int>(m_screen_height) - 8;
+        m_screen->rectangle(IntRect(Vec2i{1, oy}, Vec2i{22, 7}), 32, 1);
         m_screen->write(Vec2i(2, oy + 1), fmt::format("{} fps", 1000000 / Stats::getAverageTime("frame_time")));
         m_screen->write(Vec2i(2, oy + 2),
                         fmt::format("render time {} ms", Stats::getAverageTime("render_time") / 1000));
         m_screen->write(Vec2i(2, oy + 3),
                         fmt::format("update time {} ms", Stats::getAverageTime("update_time") / 1000));
+        m_screen->write(Vec2i(2, oy + 4),
+                        fmt::format("upload {} KB", Stats::getAverage("upload_bytes") / 1024));
+        m_screen->write(Vec2i(2, oy + 5),
+                        fmt::format("gpu draw {} us", Stats::getAverageTime("gpu_draw_time")));
+
+        m_screen->setLayer(layer);
     }
 }
 
@@ -255,6 +315,7 @@ State &Engine::state()
 void Engine::render()
 {
     renderDebugScreen();
+    m_screen->present();
     m_screen->update();
     m_screen->render(m_projection, m_model);
 }
@@ -299,7 +360,7 @@ void Engine::keyEventHandler(const event::KeyPressed &keyPress)
 
     if (keyPress.code == Key::F1) {
         m_fps_overlay = !m_fps_overlay;
-        m_screen->clear();
+        m_screen->setLayerVisible(OVERLAY_LAYER, m_fps_overlay);
     }
 
     if (keyPress.code == Key::F2) {
@@ -52,6 +52,11 @@ class Engine
   public:
     enum class DebugScreen { NONE, CHAR_DUMP, LOADING, CRASH };
 
+    // HEADLESS runs without a window or GL context, keeping the console in memory; see
+    // HeadlessBackend. TERMINAL draws the console on stdout with ANSI escapes instead and logs
+    // only to the log file. Without a window the loop runs until stop() is called.
+    enum class Backend { OPENGL, HEADLESS, TERMINAL };
+
     Engine();
     virtual ~Engine();
 
@@ -59,8 +64,13 @@ class Engine
     virtual void create(uint32_t window_width, uint32_t window_height,
                         std::unique_ptr<ConsoleScreen> console_screen,
                         const std::string &font_file, uint32_t font_width, uint32_t font_height,
-                        const std::string &title);
+                        const std::string &title, Backend backend = Backend::OPENGL);
     virtual void start();
+    void stop();
+
+    // Without a window there is no vsync to pace the loop, so it is held to this many frames a
+    // second instead. 0 lets it run flat out, for benchmarks. Has no effect with a window.
+    void setFrameRateLimit(uint32_t frames_per_second);
 
     StateStack &stateStack();
     ConsoleScreen &screen();
@@ -72,6 +82,10 @@ class Engine
     virtual void update();
 
   private:
+    // console layer the F1 overlay is drawn on, above the game's base layer.
+    static constexpr uint32_t OVERLAY_LAYER = 1;
+
+    bool createWindow(const std::string &title);
     void addDefaultHandlers();
     void renderDebugScreen();
     void keyEventHandler(const event::KeyPressed &);
@@ -79,20 +93,24 @@ class Engine
     char32_t m_dump_start      = 32;
     DebugScreen m_debug_screen = DebugScreen::NONE;
     bool m_fps_overlay         = false;
+    bool m_running             = false;
 
-    uint32_t m_window_width    = 800;
-    uint32_t m_window_height   = 600;
-    uint32_t m_screen_width    = 80;
-    uint32_t m_screen_height   = 45;
-    uint32_t m_font_width      = 8;
-    uint32_t m_font_height     = 8;
-    uint32_t m_frame_count     = 0;
+    uint32_t m_window_width     = 800;
+    uint32_t m_window_height    = 600;
+    uint32_t m_screen_width     = 80;
+    uint32_t m_screen_height    = 45;
+    uint32_t m_font_width       = 8;
+    uint32_t m_font_height      = 8;
+    uint32_t m_frame_count      = 0;
+    uint32_t m_frame_rate_limit = 60;
 
     GLFWwindow *m_window = nullptr;
     InputQueue m_input_queue;
     glm::mat4 m_projection{1.0f};
     glm::mat4 m_model{1.0f};
 
+    spdlog::sink_ptr m_stdout_sink;
+
     std::unique_ptr<ConsoleScreen> m_screen;
     std::unique_ptr<ScriptEngine> m_script_engine;
     std::unique_ptr<StateStack> m_state_stack;
@@ -0,0 +1,330 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Nathan Ollerenshaw
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "GLBackend.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include <spdlog/spdlog.h>
+
+namespace ge
+{
+
+// glBufferStorage is core from 4.4 and otherwise comes from ARB_buffer_storage, and only what the
+// loader was generated with can be asked about.
+#if defined(GL_VERSION_4_4) || defined(GL_ARB_buffer_storage)
+#define GE_HAS_BUFFER_STORAGE 1
+#endif
+
+static bool bufferStorageAvailable()
+{
+#if defined(GL_VERSION_4_4)
+    if (GLAD_GL_VERSION_4_4) return true;
+#endif
+#if defined(GL_ARB_buffer_storage)
+    if (GLAD_GL_ARB_buffer_storage) return true;
+#endif
+    return false;
+}
+
+GLBackend::~GLBackend()
+{
+    for (auto &region : m_regions) {
+        if (region.fence) glDeleteSync(region.fence);
+    }
+
+    if (m_mapped) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_instance_vbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    if (m_vao) glDeleteVertexArrays(1, &m_vao);
+    if (m_instance_vbo) glDeleteBuffers(1, &m_instance_vbo);
+    if (m_atlas_texture) glDeleteTextures(1, &m_atlas_texture);
+    if (m_palette_texture) glDeleteTextures(1, &m_palette_texture);
+}
+
+void GLBackend::create(const Vec2u grid_size, const Vec2u cell_size, const uint32_t atlas_columns)
+{
+    m_grid_size     = grid_size;
+    m_cell_size     = cell_size;
+    m_atlas_columns = atlas_columns;
+
+    const uint32_t cell_count = grid_size.x * grid_size.y;
+
+    m_region_size = static_cast<size_t>(cell_count) * sizeof(CellInstance);
+    m_region      = 0;
+
+    // every region starts out empty, so each has to be written in full before it is first drawn.
+    for (auto &region : m_regions)
+        region.pending.assign(1, {0, cell_count});
+
+    const size_t buf_size = m_region_size * STREAM_REGIONS;
+
+    // There is no per-vertex data at all; the quad corners come from gl_VertexID, so the VAO
+    // only describes the per-instance cell records.
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_instance_vbo);
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_instance_vbo);
+
+#ifdef GE_HAS_BUFFER_STORAGE
+    if (bufferStorageAvailable()) {
+        // immutable storage mapped once for the life of the buffer. It is coherent, so plain
+        // stores are visible to the next draw without any flushing.
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, buf_size, nullptr, flags);
+        m_mapped = static_cast<uint8_t *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, buf_size, flags));
+        if (!m_mapped)
+            SPDLOG_ERROR("unable to persistently map the cell instance buffer");
+    }
+#endif
+
+    if (!m_mapped)
+        glBufferData(GL_ARRAY_BUFFER, buf_size, nullptr, GL_STREAM_DRAW);
+
+    SPDLOG_INFO("cell instance ring: {} regions of {} bytes, {}", STREAM_REGIONS, m_region_size,
+                m_mapped ? "persistently mapped" : "mapped per upload");
+
+    pointInstanceAttributes(0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribDivisor(0, 1);
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+
+    glBindVertexArray(0);
+
+    // The palette lives on the GPU as a 1D texture indexed by the cell palette indices.
+    glGenTextures(1, &m_palette_texture);
+    glBindTexture(GL_TEXTURE_1D, m_palette_texture);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA8, MAX_PALETTE_COLORS, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_1D, 0);
+
+    glGenTextures(1, &m_atlas_texture);
+    glBindTexture(GL_TEXTURE_2D, m_atlas_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (!m_shader.compile(shaders::kVertexSource, shaders::kFragmentSource))
+        SPDLOG_ERROR("unable to compile the console shader");
+
+    m_uniforms.projection      = m_shader.uniformLocation("uProjection");
+    m_uniforms.model           = m_shader.uniformLocation("uModel");
+    m_uniforms.grid_width      = m_shader.uniformLocation("uGridWidth");
+    m_uniforms.cell_size       = m_shader.uniformLocation("uCellSize");
+    m_uniforms.atlas_columns   = m_shader.uniformLocation("uAtlasColumns");
+    m_uniforms.atlas_cell_size = m_shader.uniformLocation("uAtlasCellSize");
+    m_uniforms.atlas           = m_shader.uniformLocation("uAtlas");
+    m_uniforms.palette         = m_shader.uniformLocation("uPalette");
+}
+
+uint32_t GLBackend::maxAtlasSize()
+{
+    GLint max_texture_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    return static_cast<uint32_t>(max_texture_size);
+}
+
+// Replaces the whole atlas texture. Glyphs are monochrome coverage masks, so the atlas is a single
+// channel GL_R8 texture.
+void GLBackend::uploadAtlas(const uint8_t *pixels, const uint32_t width, const uint32_t height)
+{
+    m_atlas_width  = width;
+    m_atlas_height = height;
+
+    glBindTexture(GL_TEXTURE_2D, m_atlas_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void GLBackend::uploadAtlasRegion(const uint8_t *pixels, const size_t stride, const uint32_t x, const uint32_t y,
+                                  const uint32_t width, const uint32_t height)
+{
+    glBindTexture(GL_TEXTURE_2D, m_atlas_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(stride));
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RED, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+size_t GLBackend::uploadPalette(const std::vector<Color> &palette_colors)
+{
+    // always upload the full texture width so unused entries are defined.
+    std::vector<Color> palette(MAX_PALETTE_COLORS, Color::Black);
+    std::copy_n(palette_colors.begin(), std::min<size_t>(palette_colors.size(), MAX_PALETTE_COLORS), palette.begin());
+
+    glBindTexture(GL_TEXTURE_1D, m_palette_texture);
+    glTexSubImage1D(GL_TEXTURE_1D, 0, 0, MAX_PALETTE_COLORS, GL_RGBA, GL_UNSIGNED_BYTE, palette.data());
+    glBindTexture(GL_TEXTURE_1D, 0);
+
+    return palette.size() * sizeof(Color);
+}
+
+// Points the instance attributes at the region starting base bytes into the buffer. The VAO
+// must be bound; gl_InstanceID still counts from zero, so the shader doesn't care which region.
+void GLBackend::pointInstanceAttributes(const size_t base)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, m_instance_vbo);
+    // glyph: location 0
+    glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(CellInstance),
+                           (void *)(base + offsetof(CellInstance, glyph)));
+    // foreground and background palette indices: location 1
+    glVertexAttribIPointer(1, 2, GL_UNSIGNED_BYTE, sizeof(CellInstance), (void *)(base + offsetof(CellInstance, fg)));
+}
+
+// Blocks until the GPU has finished the draw that last read from region. With three regions that
+// draw was two frames ago, so in practice the fence has long been signalled.
+void GLBackend::waitForRegion(StreamRegion &region)
+{
+    if (!region.fence)
+        return;
+
+    GLenum result;
+    do {
+        result = glClientWaitSync(region.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    } while (result == GL_TIMEOUT_EXPIRED);
+
+    if (result == GL_WAIT_FAILED)
+        SPDLOG_ERROR("waiting on a cell instance fence failed");
+
+    glDeleteSync(region.fence);
+    region.fence = nullptr;
+}
+
+// Moves to the next region of the ring and brings it up to date with the current cells, which is
+// this frame's spans plus whatever changed while the region was waiting its turn.
+size_t GLBackend::uploadCells(const CellInstance *instances, const Cell *, const CellSpans &spans)
+{
+    if (spans.empty() && std::all_of(m_regions.begin(), m_regions.end(),
+                                     [](const StreamRegion &region) { return region.pending.empty(); }))
+        return 0;
+
+    for (auto &region : m_regions)
+        region.pending.insert(region.pending.end(), spans.begin(), spans.end());
+
+    m_region = (m_region + 1) % STREAM_REGIONS;
+
+    auto &region      = m_regions[m_region];
+    const size_t base = m_region * m_region_size;
+
+    waitForRegion(region);
+
+    size_t uploaded_bytes = 0;
+
+    if (m_mapped) {
+        for (auto &[first, count] : region.pending) {
+            const size_t size = static_cast<size_t>(count) * sizeof(CellInstance);
+            std::memcpy(m_mapped + base + first * sizeof(CellInstance), instances + first, size);
+            uploaded_bytes += size;
+        }
+    } else if (!region.pending.empty()) {
+        // Without buffer storage the region is mapped for just this upload. The fence already says
+        // the GPU is done with it, so the map is unsynchronized; orphaning the buffer instead would
+        // throw away the other regions and force a full upload every frame.
+        uint32_t lo = UINT32_MAX, hi = 0;
+        for (auto &[first, count] : region.pending) {
+            lo = std::min(lo, first);
+            hi = std::max(hi, first + count);
+        }
+
+        const size_t map_offset = base + static_cast<size_t>(lo) * sizeof(CellInstance);
+        const size_t map_size   = static_cast<size_t>(hi - lo) * sizeof(CellInstance);
+
+        // the range is invalidated, so all of it has to be written, clean cells between the spans
+        // included; instances holds the whole grid, so that is one copy.
+        glBindBuffer(GL_ARRAY_BUFFER, m_instance_vbo);
+        auto *mapped = glMapBufferRange(GL_ARRAY_BUFFER, map_offset, map_size,
+                                        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+
+        if (mapped) {
+            std::memcpy(mapped, instances + lo, map_size);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            uploaded_bytes += map_size;
+        } else {
+            SPDLOG_ERROR("unable to map the cell instance buffer");
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    region.pending.clear();
+
+    return uploaded_bytes;
+}
+
+void GLBackend::render(const glm::mat4 &projection, const glm::mat4 &model)
+{
+    // uniforms that haven't changed since the last frame, which is nearly all of them, are skipped
+    // by the shader program.
+    m_shader.use();
+    m_shader.setMat4(m_uniforms.projection, projection);
+    m_shader.setMat4(m_uniforms.model, model);
+    m_shader.setInt(m_uniforms.grid_width, static_cast<int>(m_grid_size.x));
+    m_shader.setVec2(m_uniforms.cell_size, Vec2f(m_cell_size.x, m_cell_size.y));
+    m_shader.setInt(m_uniforms.atlas_columns, static_cast<int>(m_atlas_columns));
+    m_shader.setVec2(m_uniforms.atlas_cell_size, Vec2f(static_cast<float>(m_cell_size.x) / m_atlas_width,
+                                                       static_cast<float>(m_cell_size.y) / m_atlas_height));
+
+    const uint32_t instance_count = m_grid_size.x * m_grid_size.y;
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_atlas_texture);
+    m_shader.setInt(m_uniforms.atlas, 0);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_1D, m_palette_texture);
+    m_shader.setInt(m_uniforms.palette, 1);
+
+    glBindVertexArray(m_vao);
+    pointInstanceAttributes(m_region * m_region_size);
+    m_draw_timer.begin();
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, VERTS_PER_CELL, instance_count);
+    m_draw_timer.end();
+
+    // replaces the fence of an earlier draw from the same region when nothing changed in between.
+    auto &region = m_regions[m_region];
+    if (region.fence) glDeleteSync(region.fence);
+    region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_1D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+} // namespace ge
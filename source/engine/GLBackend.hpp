@@ -0,0 +1,113 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Nathan Ollerenshaw
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+
+#include <glad/glad.h>
+
+#include "GpuTimer.hpp"
+#include "RenderBackend.hpp"
+#include "Shader.hpp"
+
+namespace ge
+{
+
+// Draws the console as one instanced draw call: the cells live in an instance buffer, the glyphs
+// in a single channel atlas texture and the palette in a 1D texture.
+//
+// The instance buffer is a ring of regions that each hold the whole grid. Every frame the changed
+// cells are written into the next region while the GPU may still be drawing from the others, and a
+// fence placed after each draw says when its region can be written again.
+class GLBackend : public RenderBackend
+{
+  public:
+    GLBackend() = default;
+    virtual ~GLBackend();
+
+    GLBackend(const GLBackend &) = delete;
+    GLBackend &operator=(const GLBackend &) = delete;
+
+    void create(Vec2u grid_size, Vec2u cell_size, uint32_t atlas_columns) override;
+    uint32_t maxAtlasSize() override;
+    void uploadAtlas(const uint8_t *pixels, uint32_t width, uint32_t height) override;
+    void uploadAtlasRegion(const uint8_t *pixels, size_t stride, uint32_t x, uint32_t y, uint32_t width,
+                           uint32_t height) override;
+    size_t uploadPalette(const std::vector<Color> &palette) override;
+    size_t uploadCells(const CellInstance *instances, const Cell *cells, const CellSpans &spans) override;
+    void render(const glm::mat4 &projection, const glm::mat4 &model) override;
+
+  private:
+    // each cell instance is drawn as a 4 vertex triangle strip.
+    static constexpr int VERTS_PER_CELL = 4;
+
+    // one region being written, one queued and one being drawn.
+    static constexpr size_t STREAM_REGIONS = 3;
+
+    struct StreamRegion {
+        GLsync fence = nullptr;
+        // cells changed since this region was last written, which it still has to catch up on.
+        CellSpans pending;
+    };
+
+    Vec2u m_grid_size{0, 0};
+    Vec2u m_cell_size{0, 0};
+    uint32_t m_atlas_columns = 0;
+    uint32_t m_atlas_width   = 0;
+    uint32_t m_atlas_height  = 0;
+
+    GLuint m_vao = 0, m_instance_vbo = 0;
+    GLuint m_atlas_texture   = 0;
+    GLuint m_palette_texture = 0;
+
+    std::array<StreamRegion, STREAM_REGIONS> m_regions;
+    size_t m_region_size = 0;
+    size_t m_region      = 0;
+    // the whole ring when it is persistently mapped, null when each upload maps its own range.
+    uint8_t *m_mapped = nullptr;
+
+    ShaderProgram m_shader;
+
+    // GPU side of the frame, next to the CPU timings Engine records. Uploads are CPU writes into
+    // mapped memory, so only the draw runs on the GPU.
+    GpuTimer m_draw_timer{"gpu_draw_time"};
+
+    // uniform locations, resolved once after the program links.
+    struct {
+        GLint projection      = -1;
+        GLint model           = -1;
+        GLint grid_width      = -1;
+        GLint cell_size       = -1;
+        GLint atlas_columns   = -1;
+        GLint atlas_cell_size = -1;
+        GLint atlas           = -1;
+        GLint palette         = -1;
+    } m_uniforms;
+
+    void pointInstanceAttributes(size_t base);
+    void waitForRegion(StreamRegion &region);
+};
+
+} // namespace ge
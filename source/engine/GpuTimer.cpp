@@ -0,0 +1,88 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Nathan Ollerenshaw
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "GpuTimer.hpp"
+
+#include <utility>
+
+#include "Stats.hpp"
+
+namespace ge
+{
+
+GpuTimer::GpuTimer(std::string name) : m_name(std::move(name))
+{
+}
+
+GpuTimer::~GpuTimer()
+{
+    if (m_queries[0]) glDeleteQueries(QUERY_FRAMES, m_queries.data());
+}
+
+void GpuTimer::begin()
+{
+    // queries are created on first use, once there is certain to be a context.
+    if (!m_queries[0]) glGenQueries(QUERY_FRAMES, m_queries.data());
+
+    collect();
+
+    if (m_pending[m_next])
+        return;
+
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[m_next]);
+    m_active = true;
+}
+
+void GpuTimer::end()
+{
+    if (!m_active)
+        return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    m_active          = false;
+    m_pending[m_next] = true;
+    m_next            = (m_next + 1) % QUERY_FRAMES;
+}
+
+void GpuTimer::collect()
+{
+    // oldest first, so the samples reach Stats in the order the frames were drawn.
+    for (size_t i = 0; i < QUERY_FRAMES; i++) {
+        const size_t query = (m_next + i) % QUERY_FRAMES;
+        if (!m_pending[query])
+            continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(m_queries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+
+        GLuint64 elapsed_ns = 0;
+        glGetQueryObjectui64v(m_queries[query], GL_QUERY_RESULT, &elapsed_ns);
+        Stats::record(m_name, elapsed_ns / 1000);
+        m_pending[query] = false;
+    }
+}
+
+} // namespace ge
@@ -0,0 +1,66 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Nathan Ollerenshaw
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <string>
+
+#include <glad/glad.h>
+
+namespace ge
+{
+
+// Measures how long the GPU spends on the commands issued between begin() and end() with
+// GL_TIME_ELAPSED queries, and records the result in Stats under name, in microseconds.
+//
+// Results arrive a few frames late, so each timer cycles through several queries and only reads
+// back the ones that are already available; it never waits on the GPU. If all of them are still
+// in flight that frame simply goes untimed.
+class GpuTimer
+{
+  public:
+    explicit GpuTimer(std::string name);
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer &) = delete;
+    GpuTimer &operator=(const GpuTimer &) = delete;
+
+    void begin();
+    void end();
+
+    // records any results that have come back since the last call.
+    void collect();
+
+  private:
+    static constexpr size_t QUERY_FRAMES = 3;
+
+    std::string m_name;
+    std::array<GLuint, QUERY_FRAMES> m_queries{};
+    std::array<bool, QUERY_FRAMES> m_pending{};
+    size_t m_next = 0;
+    bool m_active = false;
+};
+
+} // namespace ge
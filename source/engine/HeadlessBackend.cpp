@@ -0,0 +1,241 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Nathan Ollerenshaw
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "HeadlessBackend.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include <spdlog/spdlog.h>
+
+namespace ge
+{
+
+// rasterized pixels are Colors packed into a uint32_t.
+static_assert(sizeof(Color) == sizeof(uint32_t), "Color must be 4 bytes");
+
+void HeadlessBackend::create(const Vec2u grid_size, const Vec2u cell_size, const uint32_t atlas_columns)
+{
+    m_grid_size     = grid_size;
+    m_cell_size     = cell_size;
+    m_atlas_columns = atlas_columns;
+
+    m_cells.assign(static_cast<size_t>(grid_size.x) * grid_size.y, CellInstance{0, 0, 0, 0});
+    m_image.assign(static_cast<size_t>(grid_size.x) * cell_size.x * grid_size.y * cell_size.y, 0);
+    m_raster_all = true;
+}
+
+uint32_t HeadlessBackend::maxAtlasSize()
+{
+    return 0;
+}
+
+void HeadlessBackend::uploadAtlas(const uint8_t *pixels, const uint32_t width, const uint32_t height)
+{
+    m_atlas_size = Vec2u(width, height);
+    m_atlas.assign(pixels, pixels + static_cast<size_t>(width) * height);
+    m_raster_all = true;
+}
+
+void HeadlessBackend::uploadAtlasRegion(const uint8_t *pixels, const size_t stride, const uint32_t x,
+                                        const uint32_t y, const uint32_t width, const uint32_t height)
+{
+    for (uint32_t row = 0; row < height; row++)
+        std::memcpy(&m_atlas[x + static_cast<size_t>(y + row) * m_atlas_size.x], pixels + row * stride, width);
+}
+
+size_t HeadlessBackend::uploadPalette(const std::vector<Color> &palette)
+{
+    m_palette = palette;
+
+    uint32_t black;
+    std::memcpy(&black, &Color::Black, sizeof(uint32_t));
+    m_palette_pixels.fill(black);
+
+    for (size_t i = 0; i < std::min<size_t>(palette.size(), MAX_PALETTE_COLORS); i++)
+        std::memcpy(&m_palette_pixels[i], &palette[i], sizeof(uint32_t));
+
+    m_raster_all = true;
+
+    return palette.size() * sizeof(Color);
+}
+
+size_t HeadlessBackend::uploadCells(const CellInstance *instances, const Cell *, const CellSpans &spans)
+{
+    size_t uploaded_bytes = 0;
+
+    for (auto &[first, count] : spans) {
+        std::copy_n(instances + first, count, m_cells.begin() + first);
+        if (!m_raster_all) {
+            m_raster_spans.emplace_back(first, count);
+            m_raster_cells += count;
+        }
+        uploaded_bytes += static_cast<size_t>(count) * sizeof(CellInstance);
+    }
+
+    // once the spans add up to more than the grid, redrawing all of it is no more work, and the
+    // list stops growing while nothing is rasterizing.
+    if (m_raster_cells > m_cells.size()) {
+        m_raster_spans.clear();
+        m_raster_cells = 0;
+        m_raster_all   = true;
+    }
+
+    return uploaded_bytes;
+}
+
+void HeadlessBackend::render(const glm::mat4 &, const glm::mat4 &)
+{
+    m_frame_count++;
+}
+
+const Vec2u HeadlessBackend::gridSize()
+{
+    return m_grid_size;
+}
+
+const Vec2u HeadlessBackend::cellSize()
+{
+    return m_cell_size;
+}
+
+const std::vector<CellInstance> &HeadlessBackend::cells()
+{
+    return m_cells;
+}
+
+const std::vector<Color> &HeadlessBackend::palette()
+{
+    return m_palette;
+}
+
+const std::vector<uint8_t> &HeadlessBackend::atlas()
+{
+    return m_atlas;
+}
+
+const Vec2u HeadlessBackend::atlasSize()
+{
+    return m_atlas_size;
+}
+
+uint32_t HeadlessBackend::atlasColumns()
+{
+    return m_atlas_columns;
+}
+
+uint64_t HeadlessBackend::frameCount()
+{
+    return m_frame_count;
+}
+
+const std::vector<uint32_t> &HeadlessBackend::rasterize()
+{
+    if (m_raster_all) {
+        rasterizeSpan(0, static_cast<uint32_t>(m_cells.size()));
+    } else {
+        for (auto &[first, count] : m_raster_spans)
+            rasterizeSpan(first, count);
+    }
+
+    m_raster_spans.clear();
+    m_raster_cells = 0;
+    m_raster_all   = false;
+
+    return m_image;
+}
+
+// Draws a run of cells a row at a time. Each pixel row of a cell reads one contiguous row of the
+// glyph's coverage from the atlas and selects fg or bg per pixel with a mask rather than a
+// branch, so the inner loop vectorizes.
+void HeadlessBackend::rasterizeSpan(const uint32_t first, const uint32_t count)
+{
+    const size_t image_width = static_cast<size_t>(m_grid_size.x) * m_cell_size.x;
+    const uint32_t end       = std::min<uint32_t>(first + count, static_cast<uint32_t>(m_cells.size()));
+
+    for (uint32_t cell = first; cell < end; cell++) {
+        const CellInstance &instance = m_cells[cell];
+
+        const uint32_t fg = m_palette_pixels[instance.fg];
+        const uint32_t bg = m_palette_pixels[instance.bg];
+
+        const size_t glyph_x = static_cast<size_t>(instance.glyph % m_atlas_columns) * m_cell_size.x;
+        const size_t glyph_y = static_cast<size_t>(instance.glyph / m_atlas_columns) * m_cell_size.y;
+
+        if (glyph_y + m_cell_size.y > m_atlas_size.y)
+            continue;
+
+        const uint8_t *coverage = &m_atlas[glyph_x + glyph_y * m_atlas_size.x];
+        uint32_t *pixels        = &m_image[static_cast<size_t>(cell % m_grid_size.x) * m_cell_size.x +
+                                    static_cast<size_t>(cell / m_grid_size.x) * m_cell_size.y * image_width];
+
+        for (uint32_t y = 0; y < m_cell_size.y; y++) {
+            for (uint32_t x = 0; x < m_cell_size.x; x++) {
+                const uint32_t mask = 0u - static_cast<uint32_t>(coverage[x] != 0);
+                pixels[x]           = (fg & mask) | (bg & ~mask);
+            }
+
+            coverage += m_atlas_size.x;
+            pixels += image_width;
+        }
+    }
+}
+
+const Vec2u HeadlessBackend::imageSize()
+{
+    return Vec2u(m_grid_size.x * m_cell_size.x, m_grid_size.y * m_cell_size.y);
+}
+
+bool HeadlessBackend::saveImage(const std::filesystem::path &path)
+{
+    const auto &image = rasterize();
+    const auto size   = imageSize();
+
+    std::vector<uint8_t> row(static_cast<size_t>(size.x) * 3);
+
+    try {
+        std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+        ofs.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+
+        ofs << "P6\n" << size.x << " " << size.y << "\n255\n";
+
+        for (uint32_t y = 0; y < size.y; y++) {
+            // pixels are r, g, b, a bytes; PPM wants r, g, b.
+            const auto *pixels = reinterpret_cast<const uint8_t *>(&image[static_cast<size_t>(y) * size.x]);
+
+            for (uint32_t x = 0; x < size.x; x++)
+                std::memcpy(&row[x * 3], &pixels[x * 4], 3);
+
+            ofs.write(reinterpret_cast<const char *>(row.data()), row.size());
+        }
+    } catch (std::system_error &e) {
+        SPDLOG_WARN("unable to write image {}: {}", path.string(), e.code().message());
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace ge
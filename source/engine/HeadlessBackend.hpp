@@ -0,0 +1,95 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Nathan Ollerenshaw
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <filesystem>
+
+#include "RenderBackend.hpp"
+
+namespace ge
+{
+
+// Keeps what would have been sent to the GPU in memory instead: the cell grid, the palette and
+// the glyph atlas. Needs no window or GL context, so the engine can run on display-less machines
+// for servers, bots and benchmarks, and the console can be inspected cell by cell or rasterized
+// to an image for thumbnails and golden-image tests.
+class HeadlessBackend : public RenderBackend
+{
+  public:
+    HeadlessBackend() = default;
+    virtual ~HeadlessBackend() = default;
+
+    void create(Vec2u grid_size, Vec2u cell_size, uint32_t atlas_columns) override;
+    uint32_t maxAtlasSize() override;
+    void uploadAtlas(const uint8_t *pixels, uint32_t width, uint32_t height) override;
+    void uploadAtlasRegion(const uint8_t *pixels, size_t stride, uint32_t x, uint32_t y, uint32_t width,
+                           uint32_t height) override;
+    size_t uploadPalette(const std::vector<Color> &palette) override;
+    size_t uploadCells(const CellInstance *instances, const Cell *cells, const CellSpans &spans) override;
+    void render(const glm::mat4 &projection, const glm::mat4 &model) override;
+
+    const Vec2u gridSize();
+    const Vec2u cellSize();
+    const std::vector<CellInstance> &cells();
+    const std::vector<Color> &palette();
+    const std::vector<uint8_t> &atlas();
+    const Vec2u atlasSize();
+    uint32_t atlasColumns();
+    uint64_t frameCount();
+
+    // Draws the console into an RGBA image the way the GL shader does, redrawing only the cells
+    // uploaded since the last call, and returns it. Pixels are r, g, b, a bytes in memory order.
+    const std::vector<uint32_t> &rasterize();
+    const Vec2u imageSize();
+
+    // rasterizes and writes the image as a binary PPM.
+    bool saveImage(const std::filesystem::path &path);
+
+  private:
+    void rasterizeSpan(uint32_t first, uint32_t count);
+
+    Vec2u m_grid_size{0, 0};
+    Vec2u m_cell_size{0, 0};
+    uint32_t m_atlas_columns = 0;
+    Vec2u m_atlas_size{0, 0};
+    uint64_t m_frame_count = 0;
+
+    std::vector<CellInstance> m_cells;
+    std::vector<Color> m_palette;
+    std::vector<uint8_t> m_atlas;
+
+    // the palette as packed pixels, unused entries black like the GL palette texture.
+    std::array<uint32_t, MAX_PALETTE_COLORS> m_palette_pixels{};
+
+    std::vector<uint32_t> m_image;
+
+    // cells uploaded since the last rasterize(), or everything after a palette or atlas change.
+    CellSpans m_raster_spans;
+    size_t m_raster_cells = 0; // cells covered by m_raster_spans, counting repeats.
+    bool m_raster_all     = true;
+};
+
+} // namespace ge
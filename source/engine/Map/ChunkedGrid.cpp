@@ -0,0 +1,181 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Nathan Ollerenshaw
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ChunkedGrid.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace ge::Map
+{
+
+size_t ChunkedGrid::ChunkCoordHash::operator()(const ChunkCoord &coord) const
+{
+    // mixes x through a multiply so neighbouring chunks don't collide along the diagonals.
+    const uint64_t x = static_cast<uint64_t>(coord.x) * 0x9e3779b97f4a7c15ull;
+    return std::hash<uint64_t>{}(x ^ static_cast<uint64_t>(coord.y));
+}
+
+uint64_t ChunkedGrid::nextTag()
+{
+    static std::atomic<uint64_t> next_tag{1};
+    return next_tag.fetch_add(1, std::memory_order_relaxed);
+}
+
+// the copy shares every chunk, and neither grid may write to them in place any more.
+ChunkedGrid::ChunkedGrid(const ChunkedGrid &other) : m_chunks(other.m_chunks)
+{
+    other.m_tag = nextTag();
+}
+
+ChunkedGrid &ChunkedGrid::operator=(const ChunkedGrid &other)
+{
+    if (this == &other)
+        return *this;
+
+    m_chunks    = other.m_chunks;
+    m_tag       = nextTag();
+    other.m_tag = nextTag();
+
+    return *this;
+}
+
+// a moved from grid is left empty, under a tag of its own.
+ChunkedGrid::ChunkedGrid(ChunkedGrid &&other) noexcept : m_chunks(std::move(other.m_chunks)), m_tag(other.m_tag)
+{
+    other.m_chunks.clear();
+    other.m_tag = nextTag();
+}
+
+ChunkedGrid &ChunkedGrid::operator=(ChunkedGrid &&other) noexcept
+{
+    if (this == &other)
+        return *this;
+
+    m_chunks = std::move(other.m_chunks);
+    m_tag    = other.m_tag;
+    other.m_chunks.clear();
+    other.m_tag = nextTag();
+
+    return *this;
+}
+
+// the shift rounds towards negative infinity, so -1 is in chunk -1 and not chunk 0.
+ChunkedGrid::ChunkCoord ChunkedGrid::chunkOf(const Position &pos)
+{
+    return ChunkCoord{pos.x >> CHUNK_SHIFT, pos.y >> CHUNK_SHIFT};
+}
+
+Bounds ChunkedGrid::chunkBounds(const ChunkCoord &coord)
+{
+    return Bounds(coord.x * CHUNK_SIZE, coord.y * CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE);
+}
+
+// Get the Tile at the given position. Anywhere nothing has been written is WALL.
+ChunkedGrid::Tile ChunkedGrid::get(const Position &pos) const
+{
+    auto chunk_it = m_chunks.find(chunkOf(pos));
+    if (chunk_it == m_chunks.end())
+        return Tile::WALL;
+
+    return chunk_it->second->get(pos.x & (CHUNK_SIZE - 1), pos.y & (CHUNK_SIZE - 1));
+}
+
+// Set the Tile at the given position, creating its chunk if needed and copying it first if it
+// might be shared with another grid.
+void ChunkedGrid::set(const Position &pos, const Tile tile)
+{
+    const auto coord = chunkOf(pos);
+    auto chunk_it    = m_chunks.find(coord);
+
+    if (chunk_it == m_chunks.end()) {
+        // writing WALL over an implicit chunk changes nothing.
+        if (tile == Tile::WALL)
+            return;
+
+        auto chunk = std::make_shared<Chunk>();
+        chunk->tiles.fill(Tile::WALL);
+        chunk->owner = m_tag;
+        chunk_it     = m_chunks.emplace(coord, std::move(chunk)).first;
+    } else if (chunk_it->second->owner != m_tag) {
+        auto chunk       = std::make_shared<Chunk>(*chunk_it->second);
+        chunk->owner     = m_tag;
+        chunk_it->second = std::move(chunk);
+    }
+
+    chunk_it->second->tiles[(pos.x & (CHUNK_SIZE - 1)) + (pos.y & (CHUNK_SIZE - 1)) * CHUNK_SIZE] = tile;
+}
+
+// scans the given area a chunk at a time; chunks that don't exist are all WALL.
+bool ChunkedGrid::contains(Bounds bounds, Tile type) const
+{
+    if (bounds.width() == 0 || bounds.height() == 0)
+        return false;
+
+    const int64_t right  = bounds.left() + static_cast<int64_t>(bounds.width());
+    const int64_t bottom = bounds.top() + static_cast<int64_t>(bounds.height());
+    const auto first     = chunkOf(Position(bounds.left(), bounds.top()));
+    const auto last      = chunkOf(Position(right - 1, bottom - 1));
+
+    for (int64_t cy = first.y; cy <= last.y; cy++) {
+        for (int64_t cx = first.x; cx <= last.x; cx++) {
+            auto chunk_it = m_chunks.find(ChunkCoord{cx, cy});
+            if (chunk_it == m_chunks.end()) {
+                if (type == Tile::WALL)
+                    return true;
+                continue;
+            }
+
+            // the part of the area inside this chunk, in chunk local coordinates.
+            const int64_t x0 = std::max(bounds.left(), cx * CHUNK_SIZE) - cx * CHUNK_SIZE;
+            const int64_t y0 = std::max(bounds.top(), cy * CHUNK_SIZE) - cy * CHUNK_SIZE;
+            const int64_t x1 = std::min(right, (cx + 1) * CHUNK_SIZE) - cx * CHUNK_SIZE;
+            const int64_t y1 = std::min(bottom, (cy + 1) * CHUNK_SIZE) - cy * CHUNK_SIZE;
+
+            for (int64_t y = y0; y < y1; y++) {
+                for (int64_t x = x0; x < x1; x++) {
+                    if (chunk_it->second->get(x, y) == type)
+                        return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+size_t ChunkedGrid::chunkCount() const
+{
+    return m_chunks.size();
+}
+
+void ChunkedGrid::compact()
+{
+    std::erase_if(m_chunks, [](const auto &entry) {
+        auto &tiles = entry.second->tiles;
+        return std::all_of(tiles.begin(), tiles.end(), [](Tile tile) { return tile == Tile::WALL; });
+    });
+}
+
+} // namespace ge::Map
@@ -0,0 +1,142 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Nathan Ollerenshaw
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "Bounds.hpp"
+#include "Grid.hpp"
+#include "Position.hpp"
+
+namespace ge::Map
+{
+
+// An unbounded Grid for maps too large to hold as one dense array, such as the overworld.
+//
+// Tiles are stored in square chunks kept in a hash map by chunk coordinate. A chunk that has never
+// been written to doesn't exist and reads as solid WALL, so untouched areas cost no memory. Chunks
+// are shared between copies of a grid and only copied when one of them writes to a shared chunk,
+// which makes taking a copy, say for a save or a generation pass that may be thrown away, cheap.
+//
+// Every chunk is tagged with the grid that created it, and only that grid writes to it in place.
+// Copying a grid gives both the copy and the original new tags, so after a copy each of them
+// copies a chunk the first time it writes to it, without having to ask who else holds it.
+//
+// A ChunkedGrid is not safe to use from several threads at once, but once copied, the copy and
+// the original can each be used from their own thread.
+class ChunkedGrid
+{
+  public:
+    using Tile = Grid::Tile;
+
+    // chunks are CHUNK_SIZE tiles a side, and CHUNK_SIZE is a power of two so positions split
+    // into chunk and offset with a shift and a mask.
+    static constexpr int CHUNK_SHIFT    = 6;
+    static constexpr int64_t CHUNK_SIZE = int64_t{1} << CHUNK_SHIFT;
+
+    struct ChunkCoord {
+        int64_t x;
+        int64_t y;
+
+        bool operator==(const ChunkCoord &other) const = default;
+    };
+
+    struct Chunk {
+        std::array<Tile, CHUNK_SIZE * CHUNK_SIZE> tiles;
+
+        // the tag of the grid that may write to this chunk; never changes once the chunk is shared.
+        uint64_t owner;
+
+        Tile get(int64_t x, int64_t y) const
+        {
+            return tiles[x + y * CHUNK_SIZE];
+        }
+    };
+
+    ChunkedGrid() = default;
+    ChunkedGrid(const ChunkedGrid &other);
+    ChunkedGrid &operator=(const ChunkedGrid &other);
+    ChunkedGrid(ChunkedGrid &&other) noexcept;
+    ChunkedGrid &operator=(ChunkedGrid &&other) noexcept;
+
+    // Get the Tile at the given point.
+    Tile get(const Position &pos) const;
+
+    // Set the Tile at the given point.
+    void set(const Position &pos, Tile tile);
+
+    // tests if a given area contains any of the given tile
+    bool contains(Bounds bounds, Tile type) const;
+
+    // the number of chunks holding memory.
+    size_t chunkCount() const;
+
+    // the area covered by the chunk at coord.
+    static Bounds chunkBounds(const ChunkCoord &coord);
+
+    // drops chunks that have gone back to being all WALL.
+    void compact();
+
+    // calls fn(coord, chunk) for every chunk holding memory, in no particular order. Everything
+    // else is WALL.
+    template <typename Fn>
+    void forEachChunk(Fn fn) const
+    {
+        for (auto &[coord, chunk] : m_chunks)
+            fn(coord, *chunk);
+    }
+
+    // calls fn(position, tile) for every tile in the chunks holding memory.
+    template <typename Fn>
+    void forEachTile(Fn fn) const
+    {
+        forEachChunk([&](const ChunkCoord &coord, const Chunk &chunk) {
+            for (int64_t y = 0; y < CHUNK_SIZE; y++) {
+                for (int64_t x = 0; x < CHUNK_SIZE; x++)
+                    fn(Position(coord.x * CHUNK_SIZE + x, coord.y * CHUNK_SIZE + y), chunk.get(x, y));
+            }
+        });
+    }
+
+  private:
+    struct ChunkCoordHash {
+        size_t operator()(const ChunkCoord &coord) const;
+    };
+
+    std::unordered_map<ChunkCoord, std::shared_ptr<Chunk>, ChunkCoordHash> m_chunks;
+
+    // changed whenever the grid is copied, from or to; mutable as copying from a grid changes it.
+    mutable uint64_t m_tag = nextTag();
+
+    static uint64_t nextTag();
+
+    static ChunkCoord chunkOf(const Position &pos);
+};
+
+} // namespace ge::Map
@@ -1,15 +1,54 @@
 #include "Grid.hpp"
+#include <utility>
 
 namespace ge::Map
 {
 
+// a view is copied as a view, sharing the owner; anything else gets its own tiles.
+Grid::Grid(const Grid &other)
+{
+    *this = other;
+}
+
+Grid &Grid::operator=(const Grid &other)
+{
+    if (this == &other)
+        return *this;
+
+    m_width  = other.m_width;
+    m_height = other.m_height;
+    m_map    = other.m_map;
+    m_owner  = other.m_owner;
+    m_tiles  = m_owner ? other.m_tiles : std::span<const Tile>(m_map);
+
+    return *this;
+}
+
 void Grid::create(uint32_t width, uint32_t height)
+{
+    create(width, height, std::vector<Tile>(static_cast<size_t>(width) * height, Grid::Tile::WALL));
+}
+
+void Grid::create(uint32_t width, uint32_t height, std::vector<Tile> tiles)
+{
+    m_width  = width;
+    m_height = height;
+
+    m_map = std::move(tiles);
+    m_map.resize(static_cast<size_t>(m_width) * m_height, Grid::Tile::WALL);
+    m_owner.reset();
+    m_tiles = m_map;
+}
+
+void Grid::createView(uint32_t width, uint32_t height, std::span<const Tile> tiles, std::shared_ptr<const void> owner)
 {
     m_width  = width;
     m_height = height;
 
     m_map.clear();
-    m_map.resize(m_width * m_height, Grid::Tile::WALL);
+    m_map.shrink_to_fit();
+    m_owner = std::move(owner);
+    m_tiles = tiles.first(static_cast<size_t>(m_width) * m_height);
 }
 
 // Get the Tile at the given position.
@@ -19,7 +58,7 @@ Grid::Tile Grid::get(const Position &pos)
     if (pos.x < 0 || pos.x > m_width - 1 || pos.y < 0 || pos.y > m_height - 1)
         return Grid::Tile::INVALID;
 
-    return m_map[pos.x + pos.y * m_width];
+    return m_tiles[pos.x + pos.y * m_width];
 }
 
 // Set the Tile at the given position.
@@ -28,13 +67,20 @@ void Grid::set(const Position &pos, const Grid::Tile tile)
     if (pos.x < 0 || pos.x > m_width - 1 || pos.y < 0 || pos.y > m_height - 1)
         return;
 
+    // the first write to a view takes a copy, leaving the mapped tiles untouched.
+    if (m_owner) {
+        m_map.assign(m_tiles.begin(), m_tiles.end());
+        m_owner.reset();
+        m_tiles = m_map;
+    }
+
     m_map[pos.x + pos.y * m_width] = tile;
 }
 
-// returns the Tile data as raw values.
-const std::vector<Grid::Tile> &Grid::data()
+// returns the Tile data as raw values, row major.
+std::span<const Grid::Tile> Grid::data()
 {
-    return m_map;
+    return m_tiles;
 }
 
 uint32_t Grid::width() const
@@ -55,7 +101,7 @@ bool Grid::contains(Bounds bounds, Tile type)
             if (x > m_width - 1 || y > m_height - 1)
                 continue;
 
-            if (m_map[x + y * m_width] == type)
+            if (m_tiles[x + y * m_width] == type)
                 return true;
         }
     }
@@ -26,6 +26,8 @@
 
 #include "Bounds.hpp"
 #include "Position.hpp"
+#include <memory>
+#include <span>
 #include <vector>
 
 namespace ge::Map
@@ -44,16 +46,27 @@ class Grid
       CONNECTOR };
 
   public:
+    Grid() = default;
+    Grid(const Grid &other);
+    Grid &operator=(const Grid &other);
+
     void create(uint32_t width, uint32_t height);
 
+    // takes over tiles that are already filled in, width * height of them, row major.
+    void create(uint32_t width, uint32_t height, std::vector<Tile> tiles);
+
+    // uses tiles that live somewhere else, such as a mapped map file, without copying them. owner
+    // keeps them alive for as long as the grid needs them; the first set() takes a private copy.
+    void createView(uint32_t width, uint32_t height, std::span<const Tile> tiles, std::shared_ptr<const void> owner);
+
     // Get the Tile at the given point.
     virtual Tile get(const Position &pos);
 
     // Set the Tile at the given point.
     virtual void set(const Position &pos, Tile);
 
-    // returns the Tile data as raw values.
-    virtual const std::vector<Tile> &data();
+    // returns the Tile data as raw values, row major.
+    virtual std::span<const Tile> data();
 
     uint32_t width() const;
     uint32_t height() const;
@@ -64,7 +77,11 @@ class Grid
   private:
     uint32_t m_width  = 0;
     uint32_t m_height = 0;
-    std::vector<Tile> m_map; // actual map data.
+    std::vector<Tile> m_map; // actual map data, unless this is a view.
+
+    // the tiles in use: m_map, or the tiles owned by m_owner.
+    std::span<const Tile> m_tiles;
+    std::shared_ptr<const void> m_owner;
 };
 
 } // namespace ge::Map
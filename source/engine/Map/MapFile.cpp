@@ -0,0 +1,264 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Nathan Ollerenshaw
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "MapFile.hpp"
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <system_error>
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <spdlog/spdlog.h>
+
+namespace ge::Map
+{
+
+static constexpr std::array<uint8_t, 8> MAGIC = {'G', 'E', 'M', 'A', 'P', 0, 0, 0};
+
+static constexpr size_t HEADER_SIZE      = 64;
+static constexpr size_t CHUNK_ENTRY_SIZE = 16; // uint64_t offset, uint64_t size
+static constexpr uint32_t CHUNK_ROWS     = 64;
+static constexpr uint64_t DATA_ALIGNMENT = 4096;
+
+// header field offsets.
+static constexpr size_t VERSION_OFFSET     = 8;
+static constexpr size_t COMPRESSION_OFFSET = 12;
+static constexpr size_t WIDTH_OFFSET       = 16;
+static constexpr size_t HEIGHT_OFFSET      = 20;
+static constexpr size_t CHUNK_ROWS_OFFSET  = 24;
+static constexpr size_t CHUNK_COUNT_OFFSET = 28;
+static constexpr size_t DATA_OFFSET_OFFSET = 32;
+
+static void writeU32(uint8_t *out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        out[i] = static_cast<uint8_t>(value >> (i * 8));
+}
+
+static void writeU64(uint8_t *out, uint64_t value)
+{
+    writeU32(out, static_cast<uint32_t>(value));
+    writeU32(out + 4, static_cast<uint32_t>(value >> 32));
+}
+
+static uint32_t readU32(const uint8_t *in)
+{
+    return in[0] | in[1] << 8 | in[2] << 16 | static_cast<uint32_t>(in[3]) << 24;
+}
+
+static uint64_t readU64(const uint8_t *in)
+{
+    return readU32(in) | static_cast<uint64_t>(readU32(in + 4)) << 32;
+}
+
+// runs of the same tile as (count, tile) byte pairs, count being 1 to 255.
+static std::vector<uint8_t> encodeRLE(std::span<const Grid::Tile> tiles)
+{
+    std::vector<uint8_t> encoded;
+
+    for (size_t i = 0; i < tiles.size();) {
+        size_t run = 1;
+        while (run < 255 && i + run < tiles.size() && tiles[i + run] == tiles[i])
+            run++;
+
+        encoded.push_back(static_cast<uint8_t>(run));
+        encoded.push_back(static_cast<uint8_t>(tiles[i]));
+        i += run;
+    }
+
+    return encoded;
+}
+
+// fails unless the runs fill out exactly.
+static bool decodeRLE(std::span<const uint8_t> encoded, std::span<Grid::Tile> out)
+{
+    size_t written = 0;
+
+    for (size_t i = 0; i + 1 < encoded.size(); i += 2) {
+        const size_t run = encoded[i];
+        if (run == 0 || written + run > out.size())
+            return false;
+
+        std::fill_n(out.begin() + written, run, static_cast<Grid::Tile>(encoded[i + 1]));
+        written += run;
+    }
+
+    return encoded.size() % 2 == 0 && written == out.size();
+}
+
+bool MapFile::save(const std::string &path, Grid &grid, Compression compression)
+{
+    const auto tiles           = grid.data();
+    const uint64_t row_size    = grid.width();
+    const uint32_t chunk_count = (grid.height() + CHUNK_ROWS - 1) / CHUNK_ROWS;
+
+    std::vector<std::vector<uint8_t>> encoded(compression == Compression::RLE ? chunk_count : 0);
+    for (uint32_t chunk = 0; chunk < encoded.size(); chunk++) {
+        const uint64_t first = chunk * CHUNK_ROWS * row_size;
+        const uint64_t count = std::min<uint64_t>(CHUNK_ROWS * row_size, tiles.size() - first);
+        encoded[chunk]       = encodeRLE(tiles.subspan(first, count));
+    }
+
+    const uint64_t table_end   = HEADER_SIZE + static_cast<uint64_t>(chunk_count) * CHUNK_ENTRY_SIZE;
+    const uint64_t data_offset = (table_end + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+
+    // the header, the chunk table and the padding up to the tiles.
+    std::vector<uint8_t> front(data_offset, 0);
+    std::copy(MAGIC.begin(), MAGIC.end(), front.begin());
+    writeU32(&front[VERSION_OFFSET], VERSION);
+    writeU32(&front[COMPRESSION_OFFSET], static_cast<uint32_t>(compression));
+    writeU32(&front[WIDTH_OFFSET], grid.width());
+    writeU32(&front[HEIGHT_OFFSET], grid.height());
+    writeU32(&front[CHUNK_ROWS_OFFSET], CHUNK_ROWS);
+    writeU32(&front[CHUNK_COUNT_OFFSET], chunk_count);
+    writeU64(&front[DATA_OFFSET_OFFSET], data_offset);
+
+    uint64_t offset = data_offset;
+    for (uint32_t chunk = 0; chunk < chunk_count; chunk++) {
+        const uint64_t rows = std::min(CHUNK_ROWS, grid.height() - chunk * CHUNK_ROWS);
+        const uint64_t size = encoded.empty() ? rows * row_size : encoded[chunk].size();
+
+        writeU64(&front[HEADER_SIZE + chunk * CHUNK_ENTRY_SIZE], offset);
+        writeU64(&front[HEADER_SIZE + chunk * CHUNK_ENTRY_SIZE + 8], size);
+        offset += size;
+    }
+
+    // the tiles may be a view of the very file being replaced, so they're written out to a file
+    // alongside it that then takes its place, leaving the mapped file intact until it has.
+    const std::filesystem::path temp_path = path + ".tmp";
+
+    try {
+        {
+            std::ofstream ofs(temp_path, std::ios::binary | std::ios::trunc);
+            ofs.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+
+            ofs.write(reinterpret_cast<const char *>(front.data()), front.size());
+
+            if (encoded.empty()) {
+                ofs.write(reinterpret_cast<const char *>(tiles.data()), tiles.size());
+            } else {
+                for (auto &chunk : encoded)
+                    ofs.write(reinterpret_cast<const char *>(chunk.data()), chunk.size());
+            }
+        }
+
+        std::filesystem::rename(temp_path, path);
+
+        SPDLOG_INFO("saved map {} ({}x{}, {} bytes)", path, grid.width(), grid.height(), offset);
+    } catch (std::system_error &e) {
+        SPDLOG_ERROR("unable to write map {}: {}", path, e.code().message());
+
+        std::error_code ec;
+        std::filesystem::remove(temp_path, ec);
+        return false;
+    }
+
+    return true;
+}
+
+bool MapFile::load(const std::string &path, Grid &grid)
+{
+    namespace bip = boost::interprocess;
+
+    std::shared_ptr<bip::mapped_region> region;
+    try {
+        bip::file_mapping file(path.c_str(), bip::read_only);
+        region = std::make_shared<bip::mapped_region>(file, bip::read_only);
+    } catch (bip::interprocess_exception &e) {
+        SPDLOG_ERROR("unable to map {}: {}", path, e.what());
+        return false;
+    }
+
+    const auto *bytes     = static_cast<const uint8_t *>(region->get_address());
+    const uint64_t length = region->get_size();
+
+    if (length < HEADER_SIZE || !std::equal(MAGIC.begin(), MAGIC.end(), bytes)) {
+        SPDLOG_ERROR("{} is not a map file", path);
+        return false;
+    }
+
+    const uint32_t version     = readU32(bytes + VERSION_OFFSET);
+    const uint32_t compression = readU32(bytes + COMPRESSION_OFFSET);
+    const uint32_t width       = readU32(bytes + WIDTH_OFFSET);
+    const uint32_t height      = readU32(bytes + HEIGHT_OFFSET);
+    const uint32_t chunk_rows  = readU32(bytes + CHUNK_ROWS_OFFSET);
+    const uint32_t chunk_count = readU32(bytes + CHUNK_COUNT_OFFSET);
+    const uint64_t data_offset = readU64(bytes + DATA_OFFSET_OFFSET);
+    const uint64_t tile_count  = static_cast<uint64_t>(width) * height;
+
+    if (version == 0 || version > VERSION) {
+        SPDLOG_ERROR("{} is map file version {}, only {} is supported", path, version, VERSION);
+        return false;
+    }
+
+    if (compression > static_cast<uint32_t>(Compression::RLE) || chunk_rows == 0 ||
+        chunk_count != (static_cast<uint64_t>(height) + chunk_rows - 1) / chunk_rows ||
+        HEADER_SIZE + static_cast<uint64_t>(chunk_count) * CHUNK_ENTRY_SIZE > length || data_offset > length) {
+        SPDLOG_ERROR("{} has a corrupt header", path);
+        return false;
+    }
+
+    if (static_cast<Compression>(compression) == Compression::NONE) {
+        if (tile_count > length - data_offset) {
+            SPDLOG_ERROR("{} is truncated", path);
+            return false;
+        }
+
+        // the tiles are used where they are; the grid keeps the mapping alive.
+        const auto *tiles = reinterpret_cast<const Grid::Tile *>(bytes + data_offset);
+        grid.createView(width, height, std::span<const Grid::Tile>(tiles, tile_count), region);
+
+        SPDLOG_INFO("mapped map {} ({}x{})", path, width, height);
+        return true;
+    }
+
+    std::vector<Grid::Tile> tiles(tile_count);
+
+    for (uint32_t chunk = 0; chunk < chunk_count; chunk++) {
+        const uint8_t *entry  = bytes + HEADER_SIZE + static_cast<size_t>(chunk) * CHUNK_ENTRY_SIZE;
+        const uint64_t offset = readU64(entry);
+        const uint64_t size   = readU64(entry + 8);
+        const uint64_t first  = static_cast<uint64_t>(chunk) * chunk_rows * width;
+        const uint64_t count  = std::min<uint64_t>(static_cast<uint64_t>(chunk_rows) * width, tile_count - first);
+
+        if (offset > length || size > length - offset ||
+            !decodeRLE(std::span<const uint8_t>(bytes + offset, size), std::span(tiles).subspan(first, count))) {
+            SPDLOG_ERROR("{} has a corrupt chunk {}", path, chunk);
+            return false;
+        }
+    }
+
+    grid.create(width, height, std::move(tiles));
+
+    SPDLOG_INFO("loaded map {} ({}x{})", path, width, height);
+    return true;
+}
+
+} // namespace ge::Map
@@ -0,0 +1,55 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Nathan Ollerenshaw
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "Grid.hpp"
+
+namespace ge::Map
+{
+
+// Saves and loads a Grid as a binary map file, so a level can be loaded instead of generated again.
+//
+// The file is a 64 byte header, a table of chunks, then the tiles starting on a 4096 byte
+// boundary. All numbers are little-endian and tiles are one byte each. Each chunk is a band of
+// rows. Uncompressed chunks follow on from each other, which makes the tiles one row major array:
+// loading such a file maps it into memory and the Grid reads straight from the mapping, so tiles
+// are only read from disk as they are touched. RLE compressed files are smaller, for archives, but
+// have to be decoded into the Grid when they are loaded.
+class MapFile
+{
+  public:
+    enum class Compression : uint32_t { NONE, RLE };
+
+    // bumped whenever the layout changes; files from a newer version are refused.
+    static constexpr uint32_t VERSION = 1;
+
+    static bool save(const std::string &path, Grid &grid, Compression compression = Compression::NONE);
+    static bool load(const std::string &path, Grid &grid);
+};
+
+} // namespace ge::Map
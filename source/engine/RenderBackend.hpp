@@ -0,0 +1,101 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Nathan Ollerenshaw
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+
+#include "Types.hpp"
+
+namespace ge
+{
+
+// A console cell, packed into a single 64 bit word so that writing a cell is one store, filling
+// a row is a plain word fill and comparing rows is a memcmp.
+struct Cell {
+    // flags stored in attributes.
+    enum Attribute : uint16_t {
+        NONE        = 0,
+        SEE_THROUGH = 1 << 0, // shows the layer below instead of this cell
+    };
+
+    char32_t glyph;      // 4 bytes, codepoint
+    uint8_t fg;          // 1 byte, palette index
+    uint8_t bg;          // 1 byte, palette index
+    uint16_t attributes; // 2 bytes, Attribute flags
+
+    bool operator==(const Cell &) const = default;
+};
+
+static_assert(sizeof(Cell) == 8, "Cell must pack into a single 64 bit word");
+
+// Per-cell record drawn as one instance of a quad; the position of the cell is derived from
+// gl_InstanceID, the texture coordinates from the glyph's atlas offset and the colors from the
+// palette texture, all in the shader.
+struct CellInstance {
+    uint32_t glyph;    // 4 bytes, atlas offset
+    uint8_t fg;        // 1 byte, palette index
+    uint8_t bg;        // 1 byte, palette index
+    uint16_t reserved; // 2 bytes
+};
+
+// fg and bg are a uint8_t each, so a palette can't be indexed past this many colors.
+constexpr uint32_t MAX_PALETTE_COLORS = 256;
+
+// Spans of cells (first cell, cell count) to upload.
+using CellSpans = std::vector<std::pair<uint32_t, uint32_t>>;
+
+// Where the console's cells end up. ConsoleScreen owns the cell model, the dirty tracking and the
+// CPU copy of the glyph atlas, and pushes only what changed to the backend, which may draw it on
+// the GPU or just keep it for inspection.
+class RenderBackend
+{
+  public:
+    virtual ~RenderBackend() = default;
+
+    // grid_size is in cells, cell_size in pixels; the atlas is atlas_columns glyphs wide.
+    virtual void create(Vec2u grid_size, Vec2u cell_size, uint32_t atlas_columns) = 0;
+
+    // the largest atlas width or height the backend can hold, or 0 if there is no limit.
+    virtual uint32_t maxAtlasSize() = 0;
+
+    // atlas images are one byte of coverage per pixel, rows stride pixels apart.
+    virtual void uploadAtlas(const uint8_t *pixels, uint32_t width, uint32_t height) = 0;
+    virtual void uploadAtlasRegion(const uint8_t *pixels, size_t stride, uint32_t x, uint32_t y, uint32_t width,
+                                   uint32_t height) = 0;
+
+    // these return the number of bytes sent, for the upload stats. Backends that draw glyphs use the
+    // instances; those that draw characters, like a terminal, use the cells they were built from.
+    virtual size_t uploadPalette(const std::vector<Color> &palette) = 0;
+    virtual size_t uploadCells(const CellInstance *instances, const Cell *cells, const CellSpans &spans) = 0;
+
+    virtual void render(const glm::mat4 &projection, const glm::mat4 &model) = 0;
+};
+
+} // namespace ge
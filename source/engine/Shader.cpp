@@ -24,19 +24,29 @@
 
 #include "Shader.hpp"
 
+#include <algorithm>
+#include <cstring>
+
 #include <spdlog/spdlog.h>
 #include <glm/gtc/type_ptr.hpp>
 
 namespace ge
 {
 
+// the program last passed to glUseProgram, so use() can skip rebinding it.
+static GLuint s_current_program = 0;
+
 ShaderProgram::~ShaderProgram()
 {
     if (m_program)
         glDeleteProgram(m_program);
+
+    if (s_current_program == m_program)
+        s_current_program = 0;
 }
 
-ShaderProgram::ShaderProgram(ShaderProgram &&other) noexcept : m_program(other.m_program)
+ShaderProgram::ShaderProgram(ShaderProgram &&other) noexcept
+    : m_program(other.m_program), m_uniforms(std::move(other.m_uniforms)), m_values(std::move(other.m_values))
 {
     other.m_program = 0;
 }
@@ -46,7 +56,13 @@ ShaderProgram &ShaderProgram::operator=(ShaderProgram &&other) noexcept
     if (this != &other) {
         if (m_program)
             glDeleteProgram(m_program);
-        m_program = other.m_program;
+
+        if (s_current_program == m_program)
+            s_current_program = 0;
+
+        m_program       = other.m_program;
+        m_uniforms      = std::move(other.m_uniforms);
+        m_values        = std::move(other.m_values);
         other.m_program = 0;
     }
     return *this;
@@ -98,27 +114,118 @@ bool ShaderProgram::compile(const char *vertexSource, const char *fragmentSource
 
     glDeleteShader(vs);
     glDeleteShader(fs);
+
+    if (m_program)
+        cacheUniforms();
     return m_program != 0;
 }
 
 void ShaderProgram::use() const
 {
+    if (s_current_program == m_program)
+        return;
+
     glUseProgram(m_program);
+    s_current_program = m_program;
 }
 
-void ShaderProgram::setMat4(const char *name, const glm::mat4 &mat) const
+// Looks up the location of every active uniform so that setting a uniform by name never has to
+// ask the driver.
+void ShaderProgram::cacheUniforms()
 {
-    glUniformMatrix4fv(glGetUniformLocation(m_program, name), 1, GL_FALSE, glm::value_ptr(mat));
+    m_uniforms.clear();
+    m_values.clear();
+
+    GLint count = 0, max_length = 0;
+    glGetProgramiv(m_program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(m_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+    std::vector<char> name(std::max(max_length, 1));
+
+    for (GLint i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size     = 0;
+        GLenum type    = 0;
+        glGetActiveUniform(m_program, i, static_cast<GLsizei>(name.size()), &length, &size, &type, name.data());
+
+        const GLint location = glGetUniformLocation(m_program, name.data());
+        if (location < 0)
+            continue;
+
+        m_uniforms.push_back({std::string(name.data(), length), location});
+
+        if (static_cast<size_t>(location) >= m_values.size())
+            m_values.resize(location + 1);
+    }
 }
 
-void ShaderProgram::setInt(const char *name, int value) const
+GLint ShaderProgram::uniformLocation(const char *name) const
 {
-    glUniform1i(glGetUniformLocation(m_program, name), value);
+    for (auto &uniform : m_uniforms) {
+        if (uniform.name == name)
+            return uniform.location;
+    }
+
+    return -1;
 }
 
-void ShaderProgram::setBool(const char *name, bool value) const
+bool ShaderProgram::changed(const GLint location, const void *value, const size_t size)
 {
-    glUniform1i(glGetUniformLocation(m_program, name), static_cast<int>(value));
+    if (location < 0 || static_cast<size_t>(location) >= m_values.size())
+        return false;
+
+    auto &cached = m_values[location];
+
+    if (cached.valid && std::memcmp(cached.value, value, size) == 0)
+        return false;
+
+    std::memcpy(cached.value, value, size);
+    cached.valid = true;
+
+    return true;
+}
+
+void ShaderProgram::setMat4(const GLint location, const glm::mat4 &mat)
+{
+    if (changed(location, glm::value_ptr(mat), sizeof(mat)))
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
+}
+
+void ShaderProgram::setVec2(const GLint location, const glm::vec2 &vec)
+{
+    if (changed(location, &vec, sizeof(vec)))
+        glUniform2f(location, vec.x, vec.y);
+}
+
+void ShaderProgram::setInt(const GLint location, const int value)
+{
+    if (changed(location, &value, sizeof(value)))
+        glUniform1i(location, value);
+}
+
+void ShaderProgram::setBool(const GLint location, const bool value)
+{
+    setInt(location, static_cast<int>(value));
+}
+
+void ShaderProgram::setMat4(const char *name, const glm::mat4 &mat)
+{
+    setMat4(uniformLocation(name), mat);
+}
+
+void ShaderProgram::setVec2(const char *name, const glm::vec2 &vec)
+{
+    setVec2(uniformLocation(name), vec);
+}
+
+void ShaderProgram::setInt(const char *name, const int value)
+{
+    setInt(uniformLocation(name), value);
+}
+
+void ShaderProgram::setBool(const char *name, const bool value)
+{
+    setBool(uniformLocation(name), value);
 }
 
 namespace shaders
@@ -126,41 +233,51 @@ namespace shaders
 
 const char *const kVertexSource = R"glsl(
 #version 330 core
-layout (location = 0) in vec2 aPos;
-layout (location = 1) in vec4 aColor;
-layout (location = 2) in vec2 aTexCoord;
+layout (location = 0) in uint aGlyph;
+layout (location = 1) in uvec2 aColors; // foreground, background palette indices
 
 uniform mat4 uProjection;
 uniform mat4 uModel;
+uniform int uGridWidth;       // in cells
+uniform vec2 uCellSize;       // in pixels
+uniform int uAtlasColumns;    // glyphs per atlas row
+uniform vec2 uAtlasCellSize;  // one glyph, in normalized texture coordinates
+uniform sampler1D uPalette;
 
-out vec4 vColor;
+flat out vec4 vForeground;
+flat out vec4 vBackground;
 out vec2 vTexCoord;
 
 void main()
 {
-    gl_Position = uProjection * uModel * vec4(aPos, 0.0, 1.0);
-    vColor = aColor;
-    vTexCoord = aTexCoord;
+    // corners of the quad for a 4 vertex triangle strip: (0,0) (1,0) (0,1) (1,1)
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec2 cell   = vec2(gl_InstanceID % uGridWidth, gl_InstanceID / uGridWidth);
+    vec2 glyph  = vec2(int(aGlyph) % uAtlasColumns, int(aGlyph) / uAtlasColumns);
+
+    gl_Position = uProjection * uModel * vec4((cell + corner) * uCellSize, 0.0, 1.0);
+    vForeground = texelFetch(uPalette, int(aColors.x), 0);
+    vBackground = texelFetch(uPalette, int(aColors.y), 0);
+    vTexCoord   = (glyph + corner) * uAtlasCellSize;
 }
 )glsl";
 
+// Background and glyph are resolved in the same fragment, using the atlas coverage to pick
+// between them, so the grid is drawn in a single pass with no blending.
 const char *const kFragmentSource = R"glsl(
 #version 330 core
-in vec4 vColor;
+flat in vec4 vForeground;
+flat in vec4 vBackground;
 in vec2 vTexCoord;
 
-uniform bool uUseTexture;
 uniform sampler2D uAtlas;
 
 out vec4 FragColor;
 
 void main()
 {
-    if (uUseTexture) {
-        FragColor = texture(uAtlas, vTexCoord) * vColor;
-    } else {
-        FragColor = vColor;
-    }
+    float coverage = texture(uAtlas, vTexCoord).r;
+    FragColor = mix(vBackground, vForeground, coverage);
 }
 )glsl";
 
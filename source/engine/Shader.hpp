@@ -25,9 +25,11 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
 
 namespace ge
 {
@@ -45,14 +47,43 @@ class ShaderProgram
 
     bool compile(const char *vertexSource, const char *fragmentSource);
     void use() const;
-    void setMat4(const char *name, const glm::mat4 &mat) const;
-    void setInt(const char *name, int value) const;
-    void setBool(const char *name, bool value) const;
+
+    // Uniform locations are looked up once when the program links. Unknown names give -1, which
+    // the setters ignore, as GL does.
+    GLint uniformLocation(const char *name) const;
+
+    // The setters apply to the program in use. Each remembers the last value it sent and skips
+    // the GL call when the value hasn't changed.
+    void setMat4(GLint location, const glm::mat4 &mat);
+    void setVec2(GLint location, const glm::vec2 &vec);
+    void setInt(GLint location, int value);
+    void setBool(GLint location, bool value);
+
+    void setMat4(const char *name, const glm::mat4 &mat);
+    void setVec2(const char *name, const glm::vec2 &vec);
+    void setInt(const char *name, int value);
+    void setBool(const char *name, bool value);
 
     GLuint id() const { return m_program; }
 
   private:
+    struct Uniform {
+        std::string name;
+        GLint location;
+    };
+
+    // the last value set at a location, large enough for a mat4.
+    struct UniformValue {
+        bool valid = false;
+        float value[16];
+    };
+
+    void cacheUniforms();
+    bool changed(GLint location, const void *value, size_t size);
+
     GLuint m_program = 0;
+    std::vector<Uniform> m_uniforms;
+    std::vector<UniformValue> m_values;
 };
 
 // Embedded GLSL 330 core shaders for the console rendering pipeline
@@ -51,14 +51,20 @@ void Stats::end(std::string name)
     auto elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(
         now - active_timer_it->second).count();
 
-    m_slices[name].push_back(elapsed_time);
+    record(name, elapsed_time);
+}
+
+// records a sample that isn't a timing, such as a byte count for the frame.
+void Stats::record(std::string name, uint64_t value)
+{
+    m_slices[name].push_back(value);
 
     if (m_slices[name].size() > m_slice_max) {
         m_slices[name].pop_front();
     }
 }
 
-uint64_t Stats::getAverageTime(std::string name)
+uint64_t Stats::getAverage(std::string name)
 {
     uint64_t total = 0;
     uint64_t count = 0;
@@ -78,4 +84,9 @@ uint64_t Stats::getAverageTime(std::string name)
     return total / count;
 }
 
+uint64_t Stats::getAverageTime(std::string name)
+{
+    return getAverage(name);
+}
+
 } // namespace ge
@@ -38,6 +38,8 @@ class Stats
     static void setMaxSlices(uint64_t);
     static void begin(std::string);
     static void end(std::string);
+    static void record(std::string, uint64_t);
+    static uint64_t getAverage(std::string);
     static uint64_t getAverageTime(std::string);
 
   private:
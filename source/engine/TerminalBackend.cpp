@@ -0,0 +1,272 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Nathan Ollerenshaw
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "TerminalBackend.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+
+#include <fmt/format.h>
+
+#include "Stats.hpp"
+#include "Utf8.hpp"
+
+namespace ge
+{
+
+// Finds the closest color in the xterm 256 color palette. Only the 6x6x6 color cube and the gray
+// ramp are considered; the first 16 entries differ from terminal to terminal.
+static uint8_t nearestXterm256(const Color &color)
+{
+    static constexpr int levels[6] = {0, 95, 135, 175, 215, 255};
+
+    auto nearestLevel = [](const int value) {
+        int best = 0;
+        for (int i = 1; i < 6; i++) {
+            if (std::abs(levels[i] - value) < std::abs(levels[best] - value))
+                best = i;
+        }
+        return best;
+    };
+
+    auto distance = [&](const int r, const int g, const int b) {
+        return (r - color.r) * (r - color.r) + (g - color.g) * (g - color.g) + (b - color.b) * (b - color.b);
+    };
+
+    const int r = nearestLevel(color.r);
+    const int g = nearestLevel(color.g);
+    const int b = nearestLevel(color.b);
+
+    // the gray ramp runs from 8 to 238 in steps of 10.
+    const int average = (color.r + color.g + color.b) / 3;
+    const int gray    = std::clamp((average - 3) / 10, 0, 23);
+    const int level   = 8 + gray * 10;
+
+    if (distance(level, level, level) < distance(levels[r], levels[g], levels[b]))
+        return static_cast<uint8_t>(232 + gray);
+
+    return static_cast<uint8_t>(16 + 36 * r + 6 * g + b);
+}
+
+// East Asian wide characters and emoji take two columns on most terminals. This errs on the side
+// of caution; after one of these the cursor position is sent again rather than assumed.
+static bool mayBeWide(const char32_t codepoint)
+{
+    return codepoint >= 0x1100 && (codepoint < 0x2000 || codepoint >= 0x2e80);
+}
+
+TerminalBackend::TerminalBackend(std::ostream &out, const ColorMode color_mode) : m_out(out), m_color_mode(color_mode)
+{
+}
+
+TerminalBackend::~TerminalBackend()
+{
+    // put the terminal back the way we found it, with the prompt below the console.
+    m_out << fmt::format("\x1b[0m\x1b[{};1H\x1b[?25h\n", m_grid_size.y);
+    m_out.flush();
+}
+
+void TerminalBackend::create(const Vec2u grid_size, const Vec2u, const uint32_t)
+{
+    m_grid_size = grid_size;
+    m_cells.assign(static_cast<size_t>(grid_size.x) * grid_size.y, Cell{32, 0, 0, Cell::NONE});
+    m_send_all = true;
+
+    // hide the cursor and clear the screen.
+    m_out << "\x1b[?25l\x1b[2J";
+    m_out.flush();
+}
+
+uint32_t TerminalBackend::maxAtlasSize()
+{
+    return 0;
+}
+
+void TerminalBackend::uploadAtlas(const uint8_t *, const uint32_t, const uint32_t)
+{
+}
+
+void TerminalBackend::uploadAtlasRegion(const uint8_t *, const size_t, const uint32_t, const uint32_t,
+                                        const uint32_t, const uint32_t)
+{
+}
+
+size_t TerminalBackend::uploadPalette(const std::vector<Color> &palette)
+{
+    m_palette = palette;
+
+    m_palette_256.fill(16);
+    for (size_t i = 0; i < std::min<size_t>(palette.size(), MAX_PALETTE_COLORS); i++)
+        m_palette_256[i] = nearestXterm256(palette[i]);
+
+    // every cell on the terminal was drawn with the old colors.
+    m_send_all = true;
+
+    return palette.size() * sizeof(Color);
+}
+
+// Spans may include unchanged cells that were coalesced for the GPU's sake; only the cells that
+// differ from what the terminal already shows are queued.
+size_t TerminalBackend::uploadCells(const CellInstance *, const Cell *cells, const CellSpans &spans)
+{
+    size_t uploaded_bytes = 0;
+
+    for (auto &[first, count] : spans) {
+        for (uint32_t cell = first; cell < first + count; cell++) {
+            if (cells[cell] == m_cells[cell])
+                continue;
+
+            m_cells[cell] = cells[cell];
+
+            if (!m_pending_spans.empty() && m_pending_spans.back().first + m_pending_spans.back().second == cell)
+                m_pending_spans.back().second++;
+            else
+                m_pending_spans.emplace_back(cell, 1);
+        }
+
+        uploaded_bytes += static_cast<size_t>(count) * sizeof(Cell);
+    }
+
+    return uploaded_bytes;
+}
+
+void TerminalBackend::render(const glm::mat4 &, const glm::mat4 &)
+{
+    if (m_send_all) {
+        m_pending_spans.assign(1, {0, static_cast<uint32_t>(m_cells.size())});
+        m_cursor_known = false;
+        m_colors_known = false;
+        m_send_all     = false;
+    }
+
+    for (auto &[first, count] : m_pending_spans) {
+        for (uint32_t cell = first; cell < first + count; cell++) {
+            const uint32_t x = cell % m_grid_size.x;
+            const uint32_t y = cell / m_grid_size.x;
+
+            // over a short gap of unchanged cells in the current colors, writing them again is
+            // cheaper than any cursor movement sequence.
+            if (m_cursor_known && m_cursor.y == y && x > m_cursor.x && x - m_cursor.x <= SHORT_GAP_CELLS) {
+                const uint32_t row = y * m_grid_size.x;
+                const bool same_colors =
+                    std::all_of(&m_cells[row + m_cursor.x], &m_cells[cell], [&](const Cell &gap) {
+                        return gap.fg == m_fg && gap.bg == m_bg && !mayBeWide(gap.glyph);
+                    });
+
+                if (same_colors) {
+                    while (m_cursor.x < x)
+                        sendCell(m_cells[row + m_cursor.x]);
+                }
+            }
+
+            moveCursor(x, y);
+            sendCell(m_cells[cell]);
+        }
+    }
+
+    m_pending_spans.clear();
+
+    Stats::record("terminal_bytes", m_output.size());
+
+    if (m_output.empty())
+        return;
+
+    m_out.write(m_output.data(), m_output.size());
+    m_out.flush();
+    m_output.clear();
+}
+
+void TerminalBackend::sendCell(const Cell &cell)
+{
+    setColors(cell.fg, cell.bg);
+
+    // control characters would move the cursor; draw them as blanks.
+    utf8::encode(cell.glyph < 0x20 || cell.glyph == 0x7f ? U' ' : cell.glyph, m_output);
+
+    m_cursor.x++;
+    if (m_cursor.x == m_grid_size.x || mayBeWide(cell.glyph))
+        m_cursor_known = false;
+}
+
+// Moves the cursor to x, y unless it is already there, using a relative move along the row when
+// that is all that's needed since it is shorter than an absolute one.
+void TerminalBackend::moveCursor(const uint32_t x, const uint32_t y)
+{
+    if (m_cursor_known && m_cursor.y == y) {
+        if (m_cursor.x == x)
+            return;
+
+        if (x > m_cursor.x)
+            fmt::format_to(std::back_inserter(m_output), "\x1b[{}C", x - m_cursor.x);
+        else
+            fmt::format_to(std::back_inserter(m_output), "\x1b[{}D", m_cursor.x - x);
+    } else {
+        fmt::format_to(std::back_inserter(m_output), "\x1b[{};{}H", y + 1, x + 1);
+    }
+
+    m_cursor       = Vec2u(x, y);
+    m_cursor_known = true;
+}
+
+// Sends a single SGR sequence for whichever of the colors changed since the last cell.
+void TerminalBackend::setColors(const uint8_t fg, const uint8_t bg)
+{
+    const bool fg_changed = !m_colors_known || fg != m_fg;
+    const bool bg_changed = !m_colors_known || bg != m_bg;
+
+    if (!fg_changed && !bg_changed)
+        return;
+
+    m_output += "\x1b[";
+
+    if (fg_changed)
+        appendColor("38", fg);
+
+    if (fg_changed && bg_changed)
+        m_output += ';';
+
+    if (bg_changed)
+        appendColor("48", bg);
+
+    m_output += 'm';
+
+    m_fg           = fg;
+    m_bg           = bg;
+    m_colors_known = true;
+}
+
+void TerminalBackend::appendColor(const char *selector, const uint8_t index)
+{
+    if (m_color_mode == ColorMode::COLOR_256) {
+        fmt::format_to(std::back_inserter(m_output), "{};5;{}", selector, m_palette_256[index]);
+        return;
+    }
+
+    // entries past the end of the palette are black, as on the GPU.
+    const Color color = index < m_palette.size() ? m_palette[index] : Color::Black;
+    fmt::format_to(std::back_inserter(m_output), "{};2;{};{};{}", selector, color.r, color.g, color.b);
+}
+
+} // namespace ge
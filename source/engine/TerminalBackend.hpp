@@ -0,0 +1,97 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Nathan Ollerenshaw
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <ostream>
+#include <string>
+
+#include "RenderBackend.hpp"
+
+namespace ge
+{
+
+// Draws the console on a terminal with ANSI escape sequences, one character per cell, so the game
+// can be played over SSH. Only cells that changed are sent: the cursor is only moved when the next
+// changed cell isn't where the last one left it, and colors are only set when they differ from
+// the previous cell sent. Glyphs are written as UTF-8 and the atlas is not used at all.
+class TerminalBackend : public RenderBackend
+{
+  public:
+    // TRUECOLOR sends palette colors as 24 bit RGB; COLOR_256 maps them to the nearest entry of
+    // the xterm 256 color palette, for terminals without truecolor support.
+    enum class ColorMode { TRUECOLOR, COLOR_256 };
+
+    explicit TerminalBackend(std::ostream &out, ColorMode color_mode = ColorMode::TRUECOLOR);
+    virtual ~TerminalBackend();
+
+    TerminalBackend(const TerminalBackend &) = delete;
+    TerminalBackend &operator=(const TerminalBackend &) = delete;
+
+    void create(Vec2u grid_size, Vec2u cell_size, uint32_t atlas_columns) override;
+    uint32_t maxAtlasSize() override;
+    void uploadAtlas(const uint8_t *pixels, uint32_t width, uint32_t height) override;
+    void uploadAtlasRegion(const uint8_t *pixels, size_t stride, uint32_t x, uint32_t y, uint32_t width,
+                           uint32_t height) override;
+    size_t uploadPalette(const std::vector<Color> &palette) override;
+    size_t uploadCells(const CellInstance *instances, const Cell *cells, const CellSpans &spans) override;
+    void render(const glm::mat4 &projection, const glm::mat4 &model) override;
+
+  private:
+    // gaps between changed cells up to this long are skipped by rewriting them, not moving the cursor.
+    static constexpr uint32_t SHORT_GAP_CELLS = 3;
+
+    void sendCell(const Cell &cell);
+    void moveCursor(uint32_t x, uint32_t y);
+    void setColors(uint8_t fg, uint8_t bg);
+    void appendColor(const char *selector, uint8_t index);
+
+    std::ostream &m_out;
+    ColorMode m_color_mode;
+
+    Vec2u m_grid_size{0, 0};
+
+    // the cells as last sent, so everything can be resent when the palette changes.
+    std::vector<Cell> m_cells;
+
+    std::vector<Color> m_palette;
+    std::array<uint8_t, MAX_PALETTE_COLORS> m_palette_256{};
+
+    // cells to send on the next render(), or everything after a palette change.
+    CellSpans m_pending_spans;
+    bool m_send_all = true;
+
+    // the terminal's state as left by the last output, so redundant sequences can be skipped.
+    // The cursor is unknown after writing the last column, where terminals differ on wrapping.
+    bool m_cursor_known = false;
+    Vec2u m_cursor{0, 0};
+    bool m_colors_known = false;
+    uint8_t m_fg        = 0;
+    uint8_t m_bg        = 0;
+
+    std::string m_output;
+};
+
+} // namespace ge
@@ -25,9 +25,63 @@
 #include "TileMap.hpp"
 #include "Logging.hpp"
 
+#include <algorithm>
+#include <array>
+
 namespace ge
 {
 
+// neighbour offsets in mask bit order, high bit first.
+static const Vec2i NEIGHBOUR_OFFSETS[8] = {{-1, -1}, {0, -1}, {1, -1}, {-1, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+
+// The shape rules, written once against a neighbour mask. Each one is what the predicate of the
+// same name used to test with isEmpty calls; all but IN_ROOM need the tile itself to be empty.
+static constexpr uint32_t autotileRules(bool open, uint8_t mask)
+{
+    const bool up_left    = mask & 0x80;
+    const bool up         = mask & 0x40;
+    const bool up_right   = mask & 0x20;
+    const bool left       = mask & 0x10;
+    const bool right      = mask & 0x08;
+    const bool down_left  = mask & 0x04;
+    const bool down       = mask & 0x02;
+    const bool down_right = mask & 0x01;
+
+    if (open)
+        return (left && up && right && down) ? uint32_t{TileMap::IN_ROOM} : 0;
+
+    uint32_t bits = 0;
+
+    if (!left && !up && up_left) bits |= TileMap::CORNER_IN_UP_LEFT;
+    if (!right && !up && up_right) bits |= TileMap::CORNER_IN_UP_RIGHT;
+    if (!left && !down && down_left) bits |= TileMap::CORNER_IN_DOWN_LEFT;
+    if (!right && !down && down_right) bits |= TileMap::CORNER_IN_DOWN_RIGHT;
+    if (left && down) bits |= TileMap::CORNER_OUT_DOWN_LEFT;
+    if (up && left) bits |= TileMap::CORNER_OUT_UP_LEFT;
+    if (right && down) bits |= TileMap::CORNER_OUT_DOWN_RIGHT;
+    if (right && up) bits |= TileMap::CORNER_OUT_UP_RIGHT;
+    if (!up && left && up_left) bits |= TileMap::WALL_VERTICAL_UP_LEFT;
+    if (!down && left && down_left) bits |= TileMap::WALL_VERTICAL_DOWN_LEFT;
+    if (!up && right && up_right) bits |= TileMap::WALL_VERTICAL_UP_RIGHT;
+    if (!down && right && down_right) bits |= TileMap::WALL_VERTICAL_DOWN_RIGHT;
+    if (!left && up && up_left) bits |= TileMap::WALL_HORIZONTAL_UP_LEFT;
+    if (!right && up && up_right) bits |= TileMap::WALL_HORIZONTAL_UP_RIGHT;
+    if (!left && down && down_left) bits |= TileMap::WALL_HORIZONTAL_DOWN_LEFT;
+    if (!right && down && down_right) bits |= TileMap::WALL_HORIZONTAL_DOWN_RIGHT;
+
+    return bits;
+}
+
+// indexed by whether the tile is open, then by its neighbour mask.
+static constexpr auto AUTOTILE_TABLE = [] {
+    std::array<std::array<uint32_t, 256>, 2> table{};
+    for (int open = 0; open < 2; open++) {
+        for (int mask = 0; mask < 256; mask++)
+            table[open][mask] = autotileRules(open, static_cast<uint8_t>(mask));
+    }
+    return table;
+}();
+
 std::string TileMap::getRegionName(int region_id)
 {
     if (regions.find(region_id) == regions.end()) {
@@ -36,9 +90,13 @@ std::string TileMap::getRegionName(int region_id)
     return regions[region_id].name;
 }
 
+TileMap::Snapshot::Snapshot(int width, int height, uint64_t generation, std::vector<PackedTile> tiles)
+    : m_width(width), m_height(height), m_generation(generation), m_tiles(std::move(tiles))
+{
+}
+
 TileMap::TileMap(int width, int height)
 {
-    const std::lock_guard<std::mutex> lock(this->m_mutex);
     w                 = width;
     h                 = height;
     current_region_id = 0;
@@ -48,69 +106,143 @@ TileMap::TileMap(int width, int height)
 
     invalid_wall_tile = Tile(Tile::Type::INVALID, wall_region.id);
 
-    for (auto y = 0; y < h; y++) {
-        tiles.push_back(std::vector<Tile>());
-        for (auto x = 0; x < w; x++) {
-            tiles.back().push_back(Tile(Tile::Type::WALL, wall_region.id));
-        }
-    }
+    m_tiles.assign(static_cast<size_t>(w) * h, PackedTile(Tile::Type::WALL, wall_region.id));
+    computeNeighbours();
+
+    m_chunks_w = (w + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    m_chunks_h = (h + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    m_render_dirty.assign(static_cast<size_t>(m_chunks_w) * m_chunks_h, 1);
+    m_classify_dirty.assign(m_render_dirty.size(), 1);
+    m_rendered.resize(m_tiles.size());
+    m_classes.resize(m_tiles.size());
+    must_render = true;
+
+    // readers always have something to look at, even before the first publish.
+    publish();
 
     SPDLOG_INFO("TileMap initialized with size {}x{}", width, height);
 }
 
 Tile TileMap::getTile(Vec2i location)
 {
-    const std::lock_guard<std::mutex> lock(m_mutex);
-
-    if (location.x < 0 || location.x > w - 1 || location.y < 0 || location.y > h - 1) {
+    if (!inBounds(location)) {
         return invalid_wall_tile;
     }
 
-    auto tile = tiles[location.y][location.x];
+    return m_tiles[location.x + location.y * w].unpack();
+}
+
+// Calls fn(x0, y0, x1, y1) with the tile bounds of each chunk marked in dirty, and clears it.
+template <typename Fn>
+static void forEachDirtyChunk(std::vector<uint8_t> &dirty, int chunks_w, int w, int h, Fn fn)
+{
+    for (size_t chunk = 0; chunk < dirty.size(); chunk++) {
+        if (!dirty[chunk])
+            continue;
+
+        dirty[chunk] = 0;
 
-    return tile;
+        const int x0 = static_cast<int>(chunk % chunks_w) * TileMap::CHUNK_SIZE;
+        const int y0 = static_cast<int>(chunk / chunks_w) * TileMap::CHUNK_SIZE;
+        fn(x0, y0, std::min(x0 + TileMap::CHUNK_SIZE, w), std::min(y0 + TileMap::CHUNK_SIZE, h));
+    }
 }
 
-std::unique_ptr<std::vector<char32_t>> TileMap::render(std::map<Tile::Type, char32_t> &mapping)
+const std::vector<char32_t> &TileMap::render(const TileGlyphs &mapping)
 {
-    const std::lock_guard<std::mutex> lock(m_mutex);
-    auto mapped_tiles = std::make_unique<std::vector<char32_t>>(w * h, mapping[Tile::Type::INVALID]);
-    for (int y = 0; y < h; y++) {
-        for (int x = 0; x < w; x++) {
-            auto tile                  = tiles[y][x];
-            auto mapped_tile           = mapping[tile.type];
-            (*mapped_tiles)[x + y * w] = mapped_tile;
-        }
+    if (mapping != m_glyphs) {
+        m_glyphs = mapping;
+        std::fill(m_render_dirty.begin(), m_render_dirty.end(), 1);
     }
 
-    return mapped_tiles;
+    forEachDirtyChunk(m_render_dirty, m_chunks_w, w, h, [&](int x0, int y0, int x1, int y1) {
+        for (int y = y0; y < y1; y++) {
+            for (int x = x0; x < x1; x++) {
+                m_rendered[x + y * w] = m_glyphs[static_cast<size_t>(m_tiles[x + y * w].type())];
+            }
+        }
+    });
+
+    must_render = false;
+
+    return m_rendered;
 }
 
 void TileMap::setTile(Vec2i location, Tile::Type type, int region_id)
 {
     assert(region_id != -1);
 
-    if (location.x < 0 || location.x > w - 1 || location.y < 0 || location.y > h - 1)
+    if (!inBounds(location))
         return;
 
-    const std::lock_guard<std::mutex> lock(m_mutex);
     if (regions.find(region_id) == regions.end()) {
         SPDLOG_ERROR("TileMap::setTile for {},{} failed as region does not exist", location.x, location.y);
         return;
     }
 
-    auto tile = tiles[location.y][location.x];
-
     // set the tile to the new data.
-    tile.region_id                = region_id;
-    tile.type                     = type;
-    tiles[location.y][location.x] = tile;
+    m_tiles[location.x + location.y * w] = PackedTile(type, region_id);
+
+    markDirty(location, 0);
+
+    // only a change between open and empty moves the neighbour masks, and then only the 8 around
+    // this tile. Each of them sees this tile from the opposite direction, and as the offsets are
+    // symmetric that is bit i rather than bit 7 - i.
+    const uint8_t open = type != Tile::Type::WALL && type != Tile::Type::INVALID;
+    uint8_t &was_open  = m_open[(location.x + 1) + (location.y + 1) * (w + 2)];
+
+    if (open != was_open) {
+        was_open = open;
+        markDirty(location, 1);
+
+        for (int i = 0; i < 8; i++) {
+            const Vec2i neighbour{location.x + NEIGHBOUR_OFFSETS[i].x, location.y + NEIGHBOUR_OFFSETS[i].y};
+            if (inBounds(neighbour))
+                m_neighbours[neighbour.x + neighbour.y * w] ^= 1 << i;
+        }
+    }
 
     must_render = true;
 }
 
+// Marks the chunks holding the tiles within radius of loc as changed. A tile only changes the
+// classification of its neighbours when it turns open or empty, so only then is radius 1.
+void TileMap::markDirty(Vec2i loc, int radius)
+{
+    const int cx0 = std::max(loc.x - radius, 0) / CHUNK_SIZE;
+    const int cy0 = std::max(loc.y - radius, 0) / CHUNK_SIZE;
+    const int cx1 = std::min(loc.x + radius, w - 1) / CHUNK_SIZE;
+    const int cy1 = std::min(loc.y + radius, h - 1) / CHUNK_SIZE;
+
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            m_render_dirty[cx + cy * m_chunks_w]   = 1;
+            m_classify_dirty[cx + cy * m_chunks_w] = 1;
+        }
+    }
+}
+
+void TileMap::publish()
+{
+    auto snapshot = std::make_shared<const Snapshot>(w, h, ++m_generation, m_tiles);
+
+    const std::lock_guard<std::mutex> lock(m_snapshot_mutex);
+    m_snapshot = std::move(snapshot);
+}
+
+std::shared_ptr<const TileMap::Snapshot> TileMap::snapshot() const
+{
+    const std::lock_guard<std::mutex> lock(m_snapshot_mutex);
+    return m_snapshot;
+}
+
 int TileMap::createRegion(std::string name)
 {
+    if (current_region_id == PackedTile::MAX_REGION_ID) {
+        SPDLOG_ERROR("TileMap::createRegion failed for {} as there are too many regions", name);
+        return wall_region.id;
+    }
+
     current_region_id++;
     auto region_name = fmt::format("{}/{}", name, current_region_id);
 
@@ -121,22 +253,83 @@ int TileMap::createRegion(std::string name)
 
 void TileMap::updateRegions(int old_region_id, int new_region_id)
 {
-    int tile_count = 0;
-    const std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &tile : m_tiles) {
+        if (tile.regionId() == old_region_id) {
+            tile = PackedTile(tile.type(), new_region_id);
+        }
+    }
+}
+
+// Fills m_open and recomputes every neighbour mask in one sweep. Thanks to the padding each mask
+// is the same handful of shifts and ors of three rows, with no bounds checks or branches.
+void TileMap::computeNeighbours()
+{
+    const size_t stride = static_cast<size_t>(w) + 2;
+
+    m_open.assign(stride * (h + 2), 0);
+    m_neighbours.resize(m_tiles.size());
 
     for (int y = 0; y < h; y++) {
+        uint8_t *open            = &m_open[(y + 1) * stride + 1];
+        const PackedTile *tiles = &m_tiles[static_cast<size_t>(y) * w];
         for (int x = 0; x < w; x++) {
-            if (tiles[y][x].region_id == old_region_id) {
-                tiles[y][x].region_id = new_region_id;
-                tile_count++;
-            }
+            const auto type = tiles[x].type();
+            open[x]         = type != Tile::Type::WALL && type != Tile::Type::INVALID;
+        }
+    }
+
+    for (int y = 0; y < h; y++) {
+        const uint8_t *up   = &m_open[y * stride];
+        const uint8_t *mid  = up + stride;
+        const uint8_t *down = mid + stride;
+        uint8_t *out        = &m_neighbours[static_cast<size_t>(y) * w];
+
+        for (int x = 0; x < w; x++) {
+            out[x] = static_cast<uint8_t>(up[x] << 7 | up[x + 1] << 6 | up[x + 2] << 5 | mid[x] << 4 | mid[x + 2] << 3 |
+                                          down[x] << 2 | down[x + 1] << 1 | down[x + 2]);
         }
     }
 }
 
+// The bits, high to low, are up left, up, up right, left, right, down left, down, down right, the
+// same order as NEIGHBOUR_OFFSETS. Locations off the map are worked out the slow way.
+uint8_t TileMap::neighbourMask(Vec2i loc)
+{
+    if (inBounds(loc))
+        return m_neighbours[loc.x + loc.y * w];
+
+    uint8_t mask = 0;
+    for (int i = 0; i < 8; i++) {
+        if (!isEmpty(Vec2i{loc.x + NEIGHBOUR_OFFSETS[i].x, loc.y + NEIGHBOUR_OFFSETS[i].y}))
+            mask |= 1 << (7 - i);
+    }
+    return mask;
+}
+
+const std::vector<uint32_t> &TileMap::classify()
+{
+    const size_t stride = static_cast<size_t>(w) + 2;
+
+    forEachDirtyChunk(m_classify_dirty, m_chunks_w, w, h, [&](int x0, int y0, int x1, int y1) {
+        for (int y = y0; y < y1; y++) {
+            const uint8_t *open = &m_open[(y + 1) * stride + 1];
+            const size_t row    = static_cast<size_t>(y) * w;
+            for (int x = x0; x < x1; x++)
+                m_classes[row + x] = AUTOTILE_TABLE[open[x]][m_neighbours[row + x]];
+        }
+    });
+
+    return m_classes;
+}
+
+uint32_t TileMap::autotile(Vec2i loc)
+{
+    return AUTOTILE_TABLE[!isEmpty(loc)][neighbourMask(loc)];
+}
+
 bool TileMap::is(Vec2i loc, Tile::Type type)
 {
-    if (loc.x < 0 || loc.y < 0 || loc.x > w - 1 || loc.y > h - 1) {
+    if (!inBounds(loc)) {
         if (type == Tile::Type::WALL || type == Tile::Type::INVALID) {
             return true;
         } else {
@@ -144,142 +337,101 @@ bool TileMap::is(Vec2i loc, Tile::Type type)
         }
     }
 
-    return tiles[loc.y][loc.x].type == type;
+    return m_tiles[loc.x + loc.y * w].type() == type;
 }
 
 bool TileMap::isEmpty(Vec2i loc)
 {
-    return is(loc, Tile::Type::WALL) || is(loc, Tile::Type::INVALID);
+    if (!inBounds(loc))
+        return true;
+
+    const auto type = m_tiles[loc.x + loc.y * w].type();
+    return type == Tile::Type::WALL || type == Tile::Type::INVALID;
 }
 
 bool TileMap::isInRoom(Vec2i loc)
 {
-    return (!isEmpty(loc) && !isEmpty(Vec2i{loc.x - 1, loc.y}) && !isEmpty(Vec2i{loc.x, loc.y - 1}) &&
-            !isEmpty(Vec2i{loc.x + 1, loc.y}) && !isEmpty(Vec2i{loc.x, loc.y + 1}));
+    return autotile(loc) & IN_ROOM;
 }
 
 bool TileMap::isCornerInUpLeft(Vec2i loc)
 {
-    return (isEmpty(loc) &&                                // origin
-            isEmpty(Vec2i{loc.x - 1, loc.y}) &&     // left
-            isEmpty(Vec2i{loc.x, loc.y - 1}) &&     // down
-            !isEmpty(Vec2i{loc.x - 1, loc.y - 1})); // down left
+    return autotile(loc) & CORNER_IN_UP_LEFT;
 }
 
 bool TileMap::isCornerInUpRight(Vec2i loc)
 {
-    return (isEmpty(loc) &&                                //
-            isEmpty(Vec2i{loc.x + 1, loc.y}) &&     // right
-            isEmpty(Vec2i{loc.x, loc.y - 1}) &&     // down
-            !isEmpty(Vec2i{loc.x + 1, loc.y - 1})); // down right
+    return autotile(loc) & CORNER_IN_UP_RIGHT;
 }
 
 bool TileMap::isCornerInDownLeft(Vec2i loc)
 {
-    return (isEmpty(loc) &&                                //
-            isEmpty(Vec2i{loc.x - 1, loc.y}) &&     // left
-            isEmpty(Vec2i{loc.x, loc.y + 1}) &&     // down
-            !isEmpty(Vec2i{loc.x - 1, loc.y + 1})); // down left
+    return autotile(loc) & CORNER_IN_DOWN_LEFT;
 }
 
 bool TileMap::isCornerInDownRight(Vec2i loc)
 {
-    return (isEmpty(loc) &&                                //
-            isEmpty(Vec2i{loc.x + 1, loc.y}) &&     // right
-            isEmpty(Vec2i{loc.x, loc.y + 1}) &&     // down
-            !isEmpty(Vec2i{loc.x + 1, loc.y + 1})); // down right
+    return autotile(loc) & CORNER_IN_DOWN_RIGHT;
 }
 
 bool TileMap::isCornerOutDownLeft(Vec2i loc)
 {
-    return (isEmpty(loc) &&                             //
-            !isEmpty(Vec2i{loc.x - 1, loc.y}) && // left
-            !isEmpty(Vec2i{loc.x, loc.y + 1}));  // down
+    return autotile(loc) & CORNER_OUT_DOWN_LEFT;
 }
 
 bool TileMap::isCornerOutUpLeft(Vec2i loc)
 {
-    return (isEmpty(loc) &&                             //
-            !isEmpty(Vec2i{loc.x, loc.y - 1}) && // up
-            !isEmpty(Vec2i{loc.x - 1, loc.y}));  // left
+    return autotile(loc) & CORNER_OUT_UP_LEFT;
 }
 
 bool TileMap::isCornerOutDownRight(Vec2i loc)
 {
-    return (isEmpty(loc) &&                             //
-            !isEmpty(Vec2i{loc.x + 1, loc.y}) && // right
-            !isEmpty(Vec2i{loc.x, loc.y + 1}));  // down
+    return autotile(loc) & CORNER_OUT_DOWN_RIGHT;
 }
 
 bool TileMap::isCornerOutUpRight(Vec2i loc)
 {
-    return (isEmpty(loc) &&                             //
-            !isEmpty(Vec2i{loc.x + 1, loc.y}) && // right
-            !isEmpty(Vec2i{loc.x, loc.y - 1}));  // up
+    return autotile(loc) & CORNER_OUT_UP_RIGHT;
 }
 
 bool TileMap::isWallVerticalUpLeft(Vec2i loc)
 {
-    return (isEmpty(loc) &&                                //
-            isEmpty(Vec2i{loc.x, loc.y - 1}) &&     // up
-            !isEmpty(Vec2i{loc.x - 1, loc.y}) &&    // left
-            !isEmpty(Vec2i{loc.x - 1, loc.y - 1})); // up left
+    return autotile(loc) & WALL_VERTICAL_UP_LEFT;
 }
 
 bool TileMap::isWallVerticalDownLeft(Vec2i loc)
 {
-    return (isEmpty(loc) &&                                //
-            isEmpty(Vec2i{loc.x, loc.y + 1}) &&     // down
-            !isEmpty(Vec2i{loc.x - 1, loc.y}) &&    // left
-            !isEmpty(Vec2i{loc.x - 1, loc.y + 1})); // down left
+    return autotile(loc) & WALL_VERTICAL_DOWN_LEFT;
 }
 
 bool TileMap::isWallVerticalUpRight(Vec2i loc)
 {
-    return (isEmpty(loc) &&                                //
-            isEmpty(Vec2i{loc.x, loc.y - 1}) &&     // up
-            !isEmpty(Vec2i{loc.x + 1, loc.y}) &&    // right
-            !isEmpty(Vec2i{loc.x + 1, loc.y - 1})); // up right
+    return autotile(loc) & WALL_VERTICAL_UP_RIGHT;
 }
 
 bool TileMap::isWallVerticalDownRight(Vec2i loc)
 {
-    return (isEmpty(loc) &&                                //
-            isEmpty(Vec2i{loc.x, loc.y + 1}) &&     // down
-            !isEmpty(Vec2i{loc.x + 1, loc.y}) &&    // right
-            !isEmpty(Vec2i{loc.x + 1, loc.y + 1})); // down right
+    return autotile(loc) & WALL_VERTICAL_DOWN_RIGHT;
 }
 
 bool TileMap::isWallHorizontalUpLeft(Vec2i loc)
 {
-    return (isEmpty(loc) &&                                //
-            isEmpty(Vec2i{loc.x - 1, loc.y}) &&     // left
-            !isEmpty(Vec2i{loc.x, loc.y - 1}) &&    // up
-            !isEmpty(Vec2i{loc.x - 1, loc.y - 1})); // up left
+    return autotile(loc) & WALL_HORIZONTAL_UP_LEFT;
 }
 
 bool TileMap::isWallHorizontalUpRight(Vec2i loc)
 {
-    return (isEmpty(loc) &&                                //
-            isEmpty(Vec2i{loc.x + 1, loc.y}) &&     // right
-            !isEmpty(Vec2i{loc.x, loc.y - 1}) &&    // up
-            !isEmpty(Vec2i{loc.x + 1, loc.y - 1})); // up right
+    return autotile(loc) & WALL_HORIZONTAL_UP_RIGHT;
 }
 
 bool TileMap::isWallHorizontalDownLeft(Vec2i loc)
 {
-    return (isEmpty(loc) &&                                //
-            isEmpty(Vec2i{loc.x - 1, loc.y}) &&     // left
-            !isEmpty(Vec2i{loc.x, loc.y + 1}) &&    // down
-            !isEmpty(Vec2i{loc.x - 1, loc.y + 1})); // down left
+    return autotile(loc) & WALL_HORIZONTAL_DOWN_LEFT;
 }
 
 bool TileMap::isWallHorizontalDownRight(Vec2i loc)
 {
-    return (isEmpty(loc) &&                                //
-            isEmpty(Vec2i{loc.x + 1, loc.y}) &&     // right
-            !isEmpty(Vec2i{loc.x, loc.y + 1}) &&    // down
-            !isEmpty(Vec2i{loc.x + 1, loc.y + 1})); // down right
+    return autotile(loc) & WALL_HORIZONTAL_DOWN_RIGHT;
 }
 
 } // namespace ge
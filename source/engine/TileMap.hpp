@@ -25,11 +25,13 @@
 #pragma once
 
 #include <vector>
+#include <array>
 #include <map>
 #include <string>
 #include <random>
 #include <memory>
 #include <mutex>
+#include <cstdint>
 
 #include "Types.hpp"
 
@@ -57,6 +59,8 @@ class Tile
       CONNECTOR,
     };
 
+    static constexpr size_t TYPE_COUNT = static_cast<size_t>(Type::CONNECTOR) + 1;
+
     Type type;
     int region_id;
 
@@ -92,9 +96,137 @@ class Region // represents a region of tiles; typically rooms, hallways, stairs,
     std::string name; // a friendly name for this region.
 };
 
+// A Tile as the map stores it: the type in the low byte and the region id in the remaining 24
+// bits, so the whole map is one flat array of 32 bit words.
+class PackedTile
+{
+  public:
+    // region ids have to fit in the 24 bits left over by the type.
+    static constexpr int MAX_REGION_ID = (1 << 23) - 1;
+
+    PackedTile() = default;
+
+    PackedTile(Tile::Type type, int region_id)
+        : m_bits(static_cast<uint8_t>(type) | (static_cast<uint32_t>(region_id) << 8))
+    {
+    }
+
+    Tile::Type type() const
+    {
+        return static_cast<Tile::Type>(m_bits & 0xff);
+    }
+
+    // the arithmetic shift keeps the -1 used for tiles without a region.
+    int regionId() const
+    {
+        return static_cast<int32_t>(m_bits) >> 8;
+    }
+
+    Tile unpack() const
+    {
+        return Tile(type(), regionId());
+    }
+
+  private:
+    uint32_t m_bits = 0;
+};
+
+// The map is owned by a single writer, normally the thread generating or changing the level, and
+// only that thread may call the non-const members. Other threads read through snapshots: the
+// writer calls publish() when a batch of changes is complete, which hands out an immutable copy of
+// the tiles. A reader takes the latest snapshot once, say per AI tick, and can then query it as
+// often as it likes without locks, and without ever seeing a half made change.
 class TileMap
 {
   public:
+    // An immutable copy of the tiles as they were when the writer last published.
+    class Snapshot
+    {
+      public:
+        Snapshot(int width, int height, uint64_t generation, std::vector<PackedTile> tiles);
+
+        int width() const
+        {
+            return m_width;
+        }
+
+        int height() const
+        {
+            return m_height;
+        }
+
+        // counts publishes, so a reader can tell if it already looked at this one.
+        uint64_t generation() const
+        {
+            return m_generation;
+        }
+
+        Tile::Type type(Vec2i loc) const
+        {
+            if (loc.x < 0 || loc.y < 0 || loc.x > m_width - 1 || loc.y > m_height - 1)
+                return Tile::Type::INVALID;
+
+            return m_tiles[loc.x + loc.y * m_width].type();
+        }
+
+        Tile getTile(Vec2i loc) const
+        {
+            if (loc.x < 0 || loc.y < 0 || loc.x > m_width - 1 || loc.y > m_height - 1)
+                return Tile(Tile::Type::INVALID, 0);
+
+            return m_tiles[loc.x + loc.y * m_width].unpack();
+        }
+
+        // same rules as TileMap::is; off the map counts as wall.
+        bool is(Vec2i loc, Tile::Type type) const
+        {
+            if (loc.x < 0 || loc.y < 0 || loc.x > m_width - 1 || loc.y > m_height - 1)
+                return type == Tile::Type::WALL || type == Tile::Type::INVALID;
+
+            return m_tiles[loc.x + loc.y * m_width].type() == type;
+        }
+
+        bool isEmpty(Vec2i loc) const
+        {
+            const auto tile_type = type(loc);
+            return tile_type == Tile::Type::WALL || tile_type == Tile::Type::INVALID;
+        }
+
+      private:
+        int m_width;
+        int m_height;
+        uint64_t m_generation;
+        std::vector<PackedTile> m_tiles;
+    };
+
+    // What the autotile pass says about a tile, one bit per shape. A tile can be several shapes at
+    // once; each bit means the same as the is* predicate of the same name.
+    enum AutoTile : uint32_t {
+        IN_ROOM                    = 1 << 0,
+        CORNER_IN_UP_LEFT          = 1 << 1,
+        CORNER_IN_UP_RIGHT         = 1 << 2,
+        CORNER_IN_DOWN_LEFT        = 1 << 3,
+        CORNER_IN_DOWN_RIGHT       = 1 << 4,
+        CORNER_OUT_DOWN_LEFT       = 1 << 5,
+        CORNER_OUT_UP_LEFT         = 1 << 6,
+        CORNER_OUT_DOWN_RIGHT      = 1 << 7,
+        CORNER_OUT_UP_RIGHT        = 1 << 8,
+        WALL_VERTICAL_UP_LEFT      = 1 << 9,
+        WALL_VERTICAL_DOWN_LEFT    = 1 << 10,
+        WALL_VERTICAL_UP_RIGHT     = 1 << 11,
+        WALL_VERTICAL_DOWN_RIGHT   = 1 << 12,
+        WALL_HORIZONTAL_UP_LEFT    = 1 << 13,
+        WALL_HORIZONTAL_UP_RIGHT   = 1 << 14,
+        WALL_HORIZONTAL_DOWN_LEFT  = 1 << 15,
+        WALL_HORIZONTAL_DOWN_RIGHT = 1 << 16,
+    };
+
+    // the map is tracked for changes in square chunks of this many tiles a side.
+    static constexpr int CHUNK_SIZE = 16;
+
+    // the glyph to draw for each Tile::Type, indexed by the type.
+    using TileGlyphs = std::array<char32_t, Tile::TYPE_COUNT>;
+
     TileMap(int width, int height);
     void init();
 
@@ -105,23 +237,34 @@ class TileMap
 
     Region wall_region;
     Tile invalid_wall_tile;
-    std::vector<std::vector<Tile>> tiles;
     std::map<int, Region> regions;
 
-    // render the map into a flat uint8_t given pairs of Tile::Type to char32_t.
+    // render the map into a flat array of char32_t, row major, using the glyph for each tile type.
     // This is intended to give us a way to map the generated map to printable screen characters.
-    std::unique_ptr<std::vector<char32_t>> render(std::map<Tile::Type, char32_t> &);
-
-    // lock this when making changes
-    std::mutex m_mutex;
+    // The result is kept between calls and only the chunks changed since the last call are mapped
+    // again, unless the glyphs themselves changed.
+    const std::vector<char32_t> &render(const TileGlyphs &);
 
     Tile getTile(Vec2i);
     void setTile(Vec2i, Tile::Type, int region_id);
 
+    // makes the current tiles visible to readers on other threads.
+    void publish();
+
+    // the most recently published tiles; safe to call from any thread.
+    std::shared_ptr<const Snapshot> snapshot() const;
+
     std::string getRegionName(int);
     int createRegion(std::string); // generate a new region with a given name.
     void updateRegions(int, int);
 
+    // the AutoTile bits for every tile, row major. Like render, only the chunks changed since the
+    // last call are looked up again.
+    const std::vector<uint32_t> &classify();
+
+    // the AutoTile bits for one tile.
+    uint32_t autotile(Vec2i);
+
     bool is(Vec2i, Tile::Type);
     bool isEmpty(Vec2i);
     bool isInRoom(Vec2i);
@@ -141,6 +284,44 @@ class TileMap
     bool isWallHorizontalUpRight(Vec2i);
     bool isWallHorizontalDownLeft(Vec2i);
     bool isWallHorizontalDownRight(Vec2i);
+
+  private:
+    // row major, w * h tiles. Only the writer touches this.
+    std::vector<PackedTile> m_tiles;
+
+    uint64_t m_generation = 0;
+
+    // 1 where a tile is open, i.e. not empty. Padded with a ring of zeros, (w + 2) * (h + 2), so
+    // looking at a neighbour never needs a bounds check.
+    std::vector<uint8_t> m_open;
+
+    // for each tile, which of its 8 neighbours are open; see neighbourMask for the bit order.
+    // Kept up to date by setTile.
+    std::vector<uint8_t> m_neighbours;
+
+    // chunks that changed since the last render and classify, one byte per chunk.
+    int m_chunks_w = 0;
+    int m_chunks_h = 0;
+    std::vector<uint8_t> m_render_dirty;
+    std::vector<uint8_t> m_classify_dirty;
+
+    TileGlyphs m_glyphs{};
+    std::vector<char32_t> m_rendered;
+    std::vector<uint32_t> m_classes;
+
+    void markDirty(Vec2i loc, int radius);
+
+    void computeNeighbours();
+    uint8_t neighbourMask(Vec2i);
+
+    // guards only the swap of the published pointer, never a tile read.
+    mutable std::mutex m_snapshot_mutex;
+    std::shared_ptr<const Snapshot> m_snapshot;
+
+    bool inBounds(Vec2i loc) const
+    {
+        return loc.x >= 0 && loc.y >= 0 && loc.x < w && loc.y < h;
+    }
 };
 
 } // namespace ge
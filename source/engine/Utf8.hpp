@@ -0,0 +1,136 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Nathan Ollerenshaw
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// Allocation free UTF-8 helpers for the text paths in ConsoleScreen and the terminal backend.
+
+namespace ge::utf8
+{
+
+constexpr char32_t REPLACEMENT_CHARACTER = 0xfffd;
+
+// Returns the number of leading ASCII bytes in text. Eight bytes are tested for a set high bit at
+// a time, so plain ASCII strings are scanned a word at a time.
+inline size_t asciiPrefix(std::string_view text)
+{
+    size_t offset = 0;
+
+    for (; offset + sizeof(uint64_t) <= text.size(); offset += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, text.data() + offset, sizeof(word));
+        if (word & 0x8080808080808080ull)
+            break;
+    }
+
+    while (offset < text.size() && !(static_cast<uint8_t>(text[offset]) & 0x80))
+        offset++;
+
+    return offset;
+}
+
+// Decodes the codepoint starting at offset and advances offset past it. Malformed, overlong or
+// truncated sequences decode as U+FFFD rather than throwing.
+inline char32_t decode(std::string_view text, size_t &offset)
+{
+    const auto lead = static_cast<uint8_t>(text[offset++]);
+
+    if (lead < 0x80)
+        return lead;
+
+    size_t extra;
+    char32_t codepoint;
+    char32_t minimum;
+
+    if ((lead & 0xe0) == 0xc0) {
+        extra     = 1;
+        codepoint = lead & 0x1f;
+        minimum   = 0x80;
+    } else if ((lead & 0xf0) == 0xe0) {
+        extra     = 2;
+        codepoint = lead & 0x0f;
+        minimum   = 0x800;
+    } else if ((lead & 0xf8) == 0xf0) {
+        extra     = 3;
+        codepoint = lead & 0x07;
+        minimum   = 0x10000;
+    } else {
+        return REPLACEMENT_CHARACTER;
+    }
+
+    for (size_t i = 0; i < extra; i++) {
+        // leave a bad continuation byte in place so it starts the next sequence.
+        if (offset == text.size() || (static_cast<uint8_t>(text[offset]) & 0xc0) != 0x80)
+            return REPLACEMENT_CHARACTER;
+
+        codepoint = (codepoint << 6) | (static_cast<uint8_t>(text[offset]) & 0x3f);
+        offset++;
+    }
+
+    if (codepoint < minimum || codepoint > 0x10ffff || (codepoint >= 0xd800 && codepoint <= 0xdfff))
+        return REPLACEMENT_CHARACTER;
+
+    return codepoint;
+}
+
+// Appends codepoint to out. Surrogates and anything past U+10FFFF encode as U+FFFD.
+inline void encode(char32_t codepoint, std::string &out)
+{
+    if (codepoint > 0x10ffff || (codepoint >= 0xd800 && codepoint <= 0xdfff))
+        codepoint = REPLACEMENT_CHARACTER;
+
+    if (codepoint < 0x80) {
+        out += static_cast<char>(codepoint);
+    } else if (codepoint < 0x800) {
+        out += static_cast<char>(0xc0 | (codepoint >> 6));
+        out += static_cast<char>(0x80 | (codepoint & 0x3f));
+    } else if (codepoint < 0x10000) {
+        out += static_cast<char>(0xe0 | (codepoint >> 12));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (codepoint & 0x3f));
+    } else {
+        out += static_cast<char>(0xf0 | (codepoint >> 18));
+        out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (codepoint & 0x3f));
+    }
+}
+
+// Returns the number of codepoints in text, without validating it.
+inline size_t length(std::string_view text)
+{
+    size_t count = 0;
+    for (auto c : text) {
+        if ((static_cast<uint8_t>(c) & 0xc0) != 0x80)
+            count++;
+    }
+    return count;
+}
+
+} // namespace ge::utf8
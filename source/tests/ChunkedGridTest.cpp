@@ -0,0 +1,206 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Nathan Ollerenshaw
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+// Checks ChunkedGrid against a plain map of positions, that copies stay isolated from each other
+// however they were made, and chunking at negative coordinates.
+
+#include <cstdio>
+#include <map>
+#include <random>
+#include <utility>
+
+#include "Map/ChunkedGrid.hpp"
+
+#define CHECK(condition)                                                                                               \
+    do {                                                                                                               \
+        if (!(condition)) {                                                                                            \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);                        \
+            return 1;                                                                                                  \
+        }                                                                                                              \
+    } while (0)
+
+using namespace ge::Map;
+using Tile = ChunkedGrid::Tile;
+
+int main()
+{
+    // chunks split at multiples of CHUNK_SIZE on both sides of zero.
+    {
+        ChunkedGrid grid;
+        CHECK(grid.get(Position(-1, -1)) == Tile::WALL);
+
+        grid.set(Position(5, 5), Tile::WALL);
+        CHECK(grid.chunkCount() == 0);
+
+        grid.set(Position(-1, -1), Tile::ROOM);
+        grid.set(Position(-64, -64), Tile::DOOR);
+        CHECK(grid.chunkCount() == 1);
+        grid.set(Position(-65, -1), Tile::HALLWAY);
+        grid.set(Position(0, 0), Tile::ROOM);
+        CHECK(grid.chunkCount() == 3);
+
+        CHECK(grid.get(Position(-1, -1)) == Tile::ROOM);
+        CHECK(grid.get(Position(-64, -64)) == Tile::DOOR);
+        CHECK(grid.get(Position(-65, -1)) == Tile::HALLWAY);
+        CHECK(grid.get(Position(63, 63)) == Tile::WALL);
+
+        const auto bounds = ChunkedGrid::chunkBounds(ChunkedGrid::ChunkCoord{-1, -1});
+        CHECK(bounds.left() == -64 && bounds.top() == -64 && bounds.width() == 64 && bounds.height() == 64);
+
+        CHECK(grid.contains(Bounds(-2, -2, 4, 4), Tile::ROOM));
+        CHECK(grid.contains(Bounds(-66, -2, 2, 2), Tile::HALLWAY));
+        CHECK(!grid.contains(Bounds(-63, -63, 62, 62), Tile::DOOR));
+        CHECK(grid.contains(Bounds(1000, 1000, 1, 1), Tile::WALL));
+        CHECK(!grid.contains(Bounds(1000, 1000, 1, 1), Tile::ROOM));
+        CHECK(!grid.contains(Bounds(-1, -1, 0, 0), Tile::ROOM));
+
+        size_t tiles = 0, rooms = 0;
+        grid.forEachTile([&](const Position &pos, Tile tile) {
+            tiles++;
+            rooms += tile == Tile::ROOM;
+            if (tile != Tile::WALL && grid.get(pos) != tile)
+                rooms = 1000;
+        });
+        CHECK(tiles == 3 * 64 * 64);
+        CHECK(rooms == 2);
+
+        // chunks written back to all WALL are dropped by compact().
+        grid.set(Position(-1, -1), Tile::WALL);
+        grid.set(Position(-64, -64), Tile::WALL);
+        CHECK(grid.chunkCount() == 3);
+        grid.compact();
+        CHECK(grid.chunkCount() == 2);
+        CHECK(grid.get(Position(-65, -1)) == Tile::HALLWAY);
+    }
+
+    // random writes either side of zero read back the same as a plain map.
+    {
+        ChunkedGrid grid;
+        std::map<std::pair<int64_t, int64_t>, Tile> model;
+        std::mt19937 rng(7);
+
+        for (int i = 0; i < 20000; i++) {
+            const Position pos(static_cast<int64_t>(rng() % 400) - 200, static_cast<int64_t>(rng() % 400) - 200);
+            const auto tile = static_cast<Tile>(1 + rng() % 5);
+            grid.set(pos, tile);
+            model[{pos.x, pos.y}] = tile;
+        }
+
+        for (int64_t y = -210; y < 210; y++) {
+            for (int64_t x = -210; x < 210; x++) {
+                auto it             = model.find({x, y});
+                const Tile expected = it == model.end() ? Tile::WALL : it->second;
+                CHECK(grid.get(Position(x, y)) == expected);
+            }
+        }
+    }
+
+    // a copy and its original don't see each other's writes, whichever writes first.
+    {
+        ChunkedGrid original;
+        original.set(Position(1, 1), Tile::ROOM);
+        original.set(Position(-100, 3), Tile::ROOM);
+
+        ChunkedGrid copy(original);
+        copy.set(Position(1, 1), Tile::DOOR);
+        CHECK(original.get(Position(1, 1)) == Tile::ROOM);
+        original.set(Position(-100, 3), Tile::HALLWAY);
+        CHECK(copy.get(Position(-100, 3)) == Tile::ROOM);
+
+        // the original writes to a chunk neither has written to since the copy.
+        ChunkedGrid second(original);
+        original.set(Position(2, 2), Tile::CONNECTOR);
+        CHECK(second.get(Position(2, 2)) == Tile::WALL);
+        CHECK(copy.get(Position(2, 2)) == Tile::WALL);
+
+        // a copy of a copy.
+        ChunkedGrid third(second);
+        third.set(Position(1, 1), Tile::HALLWAY);
+        CHECK(second.get(Position(1, 1)) == Tile::ROOM);
+        CHECK(original.get(Position(1, 1)) == Tile::ROOM);
+        second.set(Position(1, 1), Tile::DOOR);
+        CHECK(third.get(Position(1, 1)) == Tile::HALLWAY);
+    }
+
+    // copy assignment, including over a grid that already has chunks of its own.
+    {
+        ChunkedGrid original;
+        original.set(Position(1, 1), Tile::ROOM);
+
+        ChunkedGrid assigned;
+        assigned.set(Position(1, 1), Tile::DOOR);
+        assigned = original;
+        CHECK(assigned.get(Position(1, 1)) == Tile::ROOM);
+
+        assigned.set(Position(1, 1), Tile::HALLWAY);
+        CHECK(original.get(Position(1, 1)) == Tile::ROOM);
+        original.set(Position(1, 1), Tile::CONNECTOR);
+        CHECK(assigned.get(Position(1, 1)) == Tile::HALLWAY);
+
+        auto &self = assigned;
+        assigned   = self;
+        CHECK(assigned.get(Position(1, 1)) == Tile::HALLWAY);
+    }
+
+    // moving keeps the chunks, and a copy taken before the move stays isolated from the new owner.
+    {
+        ChunkedGrid original;
+        original.set(Position(1, 1), Tile::ROOM);
+        ChunkedGrid copy(original);
+
+        ChunkedGrid moved(std::move(original));
+        CHECK(original.chunkCount() == 0);
+        CHECK(moved.get(Position(1, 1)) == Tile::ROOM);
+        moved.set(Position(1, 1), Tile::DOOR);
+        CHECK(copy.get(Position(1, 1)) == Tile::ROOM);
+
+        // the moved from grid can be used again without touching the chunks it gave away.
+        original.set(Position(1, 1), Tile::HALLWAY);
+        CHECK(moved.get(Position(1, 1)) == Tile::DOOR);
+
+        ChunkedGrid assigned;
+        assigned.set(Position(5, 5), Tile::ROOM);
+        assigned = std::move(moved);
+        CHECK(moved.chunkCount() == 0);
+        CHECK(assigned.get(Position(5, 5)) == Tile::WALL);
+        CHECK(assigned.get(Position(1, 1)) == Tile::DOOR);
+        assigned.set(Position(1, 1), Tile::CONNECTOR);
+        CHECK(copy.get(Position(1, 1)) == Tile::ROOM);
+    }
+
+    // compacting one grid leaves a copy's chunks alone.
+    {
+        ChunkedGrid original;
+        original.set(Position(1, 1), Tile::ROOM);
+        ChunkedGrid copy(original);
+
+        original.set(Position(1, 1), Tile::WALL);
+        original.compact();
+        CHECK(original.chunkCount() == 0);
+        CHECK(copy.chunkCount() == 1);
+        CHECK(copy.get(Position(1, 1)) == Tile::ROOM);
+    }
+
+    std::puts("chunked grid test passed");
+    return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Nathan Ollerenshaw
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Draws a few cells through the headless backend and checks what reached it, so the console can be
+// tested on machines without a GPU or a display, such as CI.
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "ConsoleScreen.hpp"
+#include "HeadlessBackend.hpp"
+#include "Logging.hpp"
+
+#define CHECK(condition)                                                                                               \
+    do {                                                                                                               \
+        if (!(condition)) {                                                                                            \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);                        \
+            return 1;                                                                                                  \
+        }                                                                                                              \
+    } while (0)
+
+int main(int argc, char *argv[])
+{
+    using namespace ge;
+
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <font file>\n", argv[0]);
+        return 1;
+    }
+
+    console = spdlog::default_logger();
+
+    auto backend   = std::make_unique<HeadlessBackend>();
+    auto &headless = *backend;
+
+    ConsoleScreen screen;
+    screen.setRenderBackend(std::move(backend));
+    screen.create(20, 4, argv[1], 8, 8, {});
+
+    screen.setForeground(7);
+    screen.setBackGround(4);
+    screen.write(Vec2i(1, 2), "hello");
+    screen.present();
+    screen.update();
+    screen.render(glm::mat4{1.0f}, glm::mat4{1.0f});
+
+    CHECK(headless.gridSize() == Vec2u(20, 4));
+    CHECK(headless.frameCount() == 1);
+
+    // every written cell got a distinct atlas slot and the colors it was written with.
+    const auto &cells = headless.cells();
+    for (int i = 0; i < 5; i++) {
+        const auto &cell = cells[2 * 20 + 1 + i];
+        CHECK(cell.fg == 7);
+        CHECK(cell.bg == 4);
+    }
+    CHECK(cells[2 * 20 + 1].glyph != cells[2 * 20 + 2].glyph);
+    CHECK(cells[2 * 20 + 3].glyph == cells[2 * 20 + 4].glyph);
+
+    // the glyphs are drawn in the foreground color somewhere inside the background of the cell.
+    const auto &image = headless.rasterize();
+    const auto size   = headless.imageSize();
+    CHECK(size == Vec2u(160, 32));
+
+    bool background = false, foreground = false;
+    for (uint32_t y = 16; y < 24; y++) {
+        for (uint32_t x = 8; x < 16; x++) {
+            const uint32_t pixel = image[x + y * size.x];
+            background           = background || pixel == image[8 + 16 * size.x];
+            foreground           = foreground || pixel != image[8 + 16 * size.x];
+        }
+    }
+    CHECK(background && foreground);
+
+    const auto path = std::filesystem::temp_directory_path() / "gridengine_headless_smoke.ppm";
+    CHECK(headless.saveImage(path));
+
+    std::ifstream ppm(path, std::ios::binary);
+    std::string magic;
+    ppm >> magic;
+    CHECK(magic == "P6");
+    CHECK(std::filesystem::file_size(path) > 160u * 32u * 3u);
+    std::filesystem::remove(path);
+
+    std::puts("headless smoke test passed");
+    return 0;
+}
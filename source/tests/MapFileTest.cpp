@@ -0,0 +1,144 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Nathan Ollerenshaw
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+// Round trips maps through MapFile in both compressions, saves a mapped map back over the file it
+// was loaded from, and checks that damaged headers are refused.
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+
+#include "Map/MapFile.hpp"
+
+#define CHECK(condition)                                                                                               \
+    do {                                                                                                               \
+        if (!(condition)) {                                                                                            \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);                        \
+            return 1;                                                                                                  \
+        }                                                                                                              \
+    } while (0)
+
+using namespace ge::Map;
+
+static bool sameTiles(Grid &a, Grid &b)
+{
+    return a.width() == b.width() && a.height() == b.height() &&
+           std::equal(a.data().begin(), a.data().end(), b.data().begin(), b.data().end());
+}
+
+// overwrites the 32 bit header field at offset in the file at path.
+static void patchU32(const std::string &path, size_t offset, uint32_t value)
+{
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(offset);
+    for (int i = 0; i < 4; i++)
+        file.put(static_cast<char>(value >> (i * 8)));
+}
+
+int main()
+{
+    const std::string path = (std::filesystem::temp_directory_path() / "gridengine_map_file_test.map").string();
+
+    // a height that isn't a whole number of chunks, and both long runs and noise for the RLE.
+    Grid grid;
+    grid.create(300, 130);
+    std::mt19937 rng(3);
+    for (int i = 0; i < 5000; i++)
+        grid.set(Position(rng() % 300, rng() % 130), static_cast<Grid::Tile>(rng() % 6));
+
+    for (auto compression : {MapFile::Compression::NONE, MapFile::Compression::RLE}) {
+        CHECK(MapFile::save(path, grid, compression));
+
+        Grid loaded;
+        CHECK(MapFile::load(path, loaded));
+        CHECK(sameTiles(grid, loaded));
+
+        // writing to a loaded grid leaves the file, and so other loads of it, alone.
+        Grid copy = loaded;
+        copy.set(Position(0, 0), Grid::Tile::DOOR);
+        CHECK(copy.get(Position(0, 0)) == Grid::Tile::DOOR);
+        CHECK(loaded.get(Position(0, 0)) == grid.get(Position(0, 0)));
+
+        Grid again;
+        CHECK(MapFile::load(path, again));
+        CHECK(sameTiles(grid, again));
+    }
+
+    // an uncompressed load reads from the mapping, and saving it over the file it maps is the
+    // autosave case: the file is replaced whole and the mapped grid still reads the old tiles.
+    CHECK(MapFile::save(path, grid));
+    Grid mapped;
+    CHECK(MapFile::load(path, mapped));
+    for (auto compression : {MapFile::Compression::NONE, MapFile::Compression::RLE, MapFile::Compression::NONE}) {
+        CHECK(MapFile::save(path, mapped, compression));
+        CHECK(sameTiles(grid, mapped));
+
+        Grid reloaded;
+        CHECK(MapFile::load(path, reloaded));
+        CHECK(sameTiles(grid, reloaded));
+    }
+    CHECK(!std::filesystem::exists(path + ".tmp"));
+
+    // damaged headers. Each case starts from a good file.
+    struct Damage {
+        size_t offset;
+        uint32_t value;
+    };
+    const Damage damages[] = {
+        {0, 0},           // magic
+        {8, 0},           // version
+        {8, 99},          // a newer version
+        {12, 7},          // compression
+        {24, 0},          // chunk rows
+        {28, 1},          // chunk count that doesn't cover the height
+        {32, 0x7fffffff}, // data offset past the end
+    };
+    for (const auto &damage : damages) {
+        CHECK(MapFile::save(path, grid));
+        patchU32(path, damage.offset, damage.value);
+
+        Grid bad;
+        CHECK(!MapFile::load(path, bad));
+    }
+
+    // a file cut short of its tiles, and a corrupt RLE chunk.
+    CHECK(MapFile::save(path, grid));
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    Grid truncated;
+    CHECK(!MapFile::load(path, truncated));
+
+    CHECK(MapFile::save(path, grid, MapFile::Compression::RLE));
+    patchU32(path, 4096, 0);
+    Grid corrupt;
+    CHECK(!MapFile::load(path, corrupt));
+
+    Grid missing;
+    std::filesystem::remove(path);
+    CHECK(!MapFile::load(path, missing));
+
+    std::puts("map file test passed");
+    return 0;
+}
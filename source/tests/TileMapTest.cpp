@@ -0,0 +1,196 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Nathan Ollerenshaw
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+// Checks the autotile lookup table against the shape predicates as they were written before it,
+// one isEmpty call per neighbour, and that the neighbour masks and the classify() and render()
+// results stay right as tiles are changed one at a time.
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "TileMap.hpp"
+
+#define CHECK(condition)                                                                                               \
+    do {                                                                                                               \
+        if (!(condition)) {                                                                                            \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);                        \
+            return 1;                                                                                                  \
+        }                                                                                                              \
+    } while (0)
+
+using namespace ge;
+
+// The predicates the table replaced, against a snapshot, which has the same isEmpty rules.
+static uint32_t referenceAutotile(const TileMap::Snapshot &map, Vec2i loc)
+{
+    auto empty = [&](int dx, int dy) { return map.isEmpty(Vec2i{loc.x + dx, loc.y + dy}); };
+
+    uint32_t bits = 0;
+
+    if (!empty(0, 0) && !empty(-1, 0) && !empty(0, -1) && !empty(1, 0) && !empty(0, 1))
+        bits |= TileMap::IN_ROOM;
+
+    if (!empty(0, 0))
+        return bits;
+
+    if (empty(-1, 0) && empty(0, -1) && !empty(-1, -1)) bits |= TileMap::CORNER_IN_UP_LEFT;
+    if (empty(1, 0) && empty(0, -1) && !empty(1, -1)) bits |= TileMap::CORNER_IN_UP_RIGHT;
+    if (empty(-1, 0) && empty(0, 1) && !empty(-1, 1)) bits |= TileMap::CORNER_IN_DOWN_LEFT;
+    if (empty(1, 0) && empty(0, 1) && !empty(1, 1)) bits |= TileMap::CORNER_IN_DOWN_RIGHT;
+    if (!empty(-1, 0) && !empty(0, 1)) bits |= TileMap::CORNER_OUT_DOWN_LEFT;
+    if (!empty(0, -1) && !empty(-1, 0)) bits |= TileMap::CORNER_OUT_UP_LEFT;
+    if (!empty(1, 0) && !empty(0, 1)) bits |= TileMap::CORNER_OUT_DOWN_RIGHT;
+    if (!empty(1, 0) && !empty(0, -1)) bits |= TileMap::CORNER_OUT_UP_RIGHT;
+    if (empty(0, -1) && !empty(-1, 0) && !empty(-1, -1)) bits |= TileMap::WALL_VERTICAL_UP_LEFT;
+    if (empty(0, 1) && !empty(-1, 0) && !empty(-1, 1)) bits |= TileMap::WALL_VERTICAL_DOWN_LEFT;
+    if (empty(0, -1) && !empty(1, 0) && !empty(1, -1)) bits |= TileMap::WALL_VERTICAL_UP_RIGHT;
+    if (empty(0, 1) && !empty(1, 0) && !empty(1, 1)) bits |= TileMap::WALL_VERTICAL_DOWN_RIGHT;
+    if (empty(-1, 0) && !empty(0, -1) && !empty(-1, -1)) bits |= TileMap::WALL_HORIZONTAL_UP_LEFT;
+    if (empty(1, 0) && !empty(0, -1) && !empty(1, -1)) bits |= TileMap::WALL_HORIZONTAL_UP_RIGHT;
+    if (empty(-1, 0) && !empty(0, 1) && !empty(-1, 1)) bits |= TileMap::WALL_HORIZONTAL_DOWN_LEFT;
+    if (empty(1, 0) && !empty(0, 1) && !empty(1, 1)) bits |= TileMap::WALL_HORIZONTAL_DOWN_RIGHT;
+
+    return bits;
+}
+
+// the predicates, packed into AutoTile bits the same way.
+static uint32_t predicateBits(TileMap &map, Vec2i loc)
+{
+    return (map.isInRoom(loc) ? TileMap::IN_ROOM : 0) |
+           (map.isCornerInUpLeft(loc) ? TileMap::CORNER_IN_UP_LEFT : 0) |
+           (map.isCornerInUpRight(loc) ? TileMap::CORNER_IN_UP_RIGHT : 0) |
+           (map.isCornerInDownLeft(loc) ? TileMap::CORNER_IN_DOWN_LEFT : 0) |
+           (map.isCornerInDownRight(loc) ? TileMap::CORNER_IN_DOWN_RIGHT : 0) |
+           (map.isCornerOutDownLeft(loc) ? TileMap::CORNER_OUT_DOWN_LEFT : 0) |
+           (map.isCornerOutUpLeft(loc) ? TileMap::CORNER_OUT_UP_LEFT : 0) |
+           (map.isCornerOutDownRight(loc) ? TileMap::CORNER_OUT_DOWN_RIGHT : 0) |
+           (map.isCornerOutUpRight(loc) ? TileMap::CORNER_OUT_UP_RIGHT : 0) |
+           (map.isWallVerticalUpLeft(loc) ? TileMap::WALL_VERTICAL_UP_LEFT : 0) |
+           (map.isWallVerticalDownLeft(loc) ? TileMap::WALL_VERTICAL_DOWN_LEFT : 0) |
+           (map.isWallVerticalUpRight(loc) ? TileMap::WALL_VERTICAL_UP_RIGHT : 0) |
+           (map.isWallVerticalDownRight(loc) ? TileMap::WALL_VERTICAL_DOWN_RIGHT : 0) |
+           (map.isWallHorizontalUpLeft(loc) ? TileMap::WALL_HORIZONTAL_UP_LEFT : 0) |
+           (map.isWallHorizontalUpRight(loc) ? TileMap::WALL_HORIZONTAL_UP_RIGHT : 0) |
+           (map.isWallHorizontalDownLeft(loc) ? TileMap::WALL_HORIZONTAL_DOWN_LEFT : 0) |
+           (map.isWallHorizontalDownRight(loc) ? TileMap::WALL_HORIZONTAL_DOWN_RIGHT : 0);
+}
+
+// every tile of map, and a ring of locations off it, against the reference predicates; and the
+// incrementally kept classify() and render() against a map built from scratch with the same tiles.
+static bool matchesReference(TileMap &map, const TileMap::TileGlyphs &glyphs)
+{
+    map.publish();
+    const auto snapshot = map.snapshot();
+
+    TileMap fresh(map.w, map.h);
+    for (int y = 0; y < map.h; y++) {
+        for (int x = 0; x < map.w; x++) {
+            const auto tile = map.getTile(Vec2i{x, y});
+            fresh.setTile(Vec2i{x, y}, tile.type, 0);
+        }
+    }
+
+    const auto &classes       = map.classify();
+    const auto &fresh_classes = fresh.classify();
+    const auto &rendered      = map.render(glyphs);
+    const auto &fresh_render  = fresh.render(glyphs);
+
+    for (int y = -1; y <= map.h; y++) {
+        for (int x = -1; x <= map.w; x++) {
+            const Vec2i loc{x, y};
+            const uint32_t expected = referenceAutotile(*snapshot, loc);
+
+            if (map.autotile(loc) != expected || predicateBits(map, loc) != expected)
+                return false;
+
+            if (map.getTile(loc).type == Tile::Type::INVALID)
+                continue;
+
+            const size_t index = x + static_cast<size_t>(y) * map.w;
+            if (classes[index] != expected || fresh_classes[index] != expected)
+                return false;
+
+            if (rendered[index] != fresh_render[index])
+                return false;
+        }
+    }
+
+    return true;
+}
+
+int main()
+{
+    TileMap::TileGlyphs glyphs{};
+    for (size_t i = 0; i < glyphs.size(); i++)
+        glyphs[i] = U'a' + static_cast<char32_t>(i);
+
+    // every half of the table: the centre of a 3x3 map, open or empty, under each neighbour mask.
+    // Bit order matches TileMap's, high bit first from the top left.
+    static const Vec2i offsets[8] = {{-1, -1}, {0, -1}, {1, -1}, {-1, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+
+    for (int open = 0; open < 2; open++) {
+        for (int mask = 0; mask < 256; mask++) {
+            TileMap map(3, 3);
+            map.setTile(Vec2i{1, 1}, open ? Tile::Type::ROOM : Tile::Type::WALL, 0);
+            for (int i = 0; i < 8; i++) {
+                if (mask & (0x80 >> i))
+                    map.setTile(Vec2i{1 + offsets[i].x, 1 + offsets[i].y}, Tile::Type::HALLWAY, 0);
+            }
+
+            map.publish();
+            const uint32_t expected = referenceAutotile(*map.snapshot(), Vec2i{1, 1});
+            CHECK(map.autotile(Vec2i{1, 1}) == expected);
+            CHECK(map.classify()[4] == expected);
+            CHECK(predicateBits(map, Vec2i{1, 1}) == expected);
+        }
+    }
+
+    // a map wider than a chunk and not a whole number of them, changed a few tiles at a time,
+    // including back and forth between open and empty and at the edges.
+    TileMap map(TileMap::CHUNK_SIZE * 2 + 5, TileMap::CHUNK_SIZE + 3);
+    CHECK(matchesReference(map, glyphs));
+
+    static const Tile::Type types[] = {Tile::Type::WALL,   Tile::Type::ROOM,        Tile::Type::HALLWAY,
+                                       Tile::Type::DOOR,   Tile::Type::SECRET_DOOR, Tile::Type::INVALID,
+                                       Tile::Type::EGRESS, Tile::Type::CONNECTOR};
+    std::mt19937 rng(11);
+
+    for (int batch = 0; batch < 60; batch++) {
+        const int changes = 1 + rng() % 12;
+        for (int i = 0; i < changes; i++) {
+            const Vec2i loc{static_cast<int>(rng() % map.w), static_cast<int>(rng() % map.h)};
+            map.setTile(loc, types[rng() % std::size(types)], 0);
+        }
+
+        CHECK(matchesReference(map, glyphs));
+    }
+
+    // off the map writes change nothing.
+    map.setTile(Vec2i{-1, 0}, Tile::Type::ROOM, 0);
+    map.setTile(Vec2i{map.w, map.h}, Tile::Type::ROOM, 0);
+    CHECK(matchesReference(map, glyphs));
+
+    std::puts("tile map test passed");
+    return 0;
+}